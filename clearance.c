@@ -0,0 +1,279 @@
+#include "clearance.h"
+
+/* Distance between samples of the swept area, in meters */
+#define SWEEP_STEP 0.005
+/* Minimum clearance between the mouse and any post or wall, in meters */
+#define SWEEP_CLEARANCE 0.005
+
+/**
+ * @brief Check whether a segment crosses the mouse footprint.
+ *
+ * The footprint is the mouse rectangle, enlarged with half the wall width
+ * plus the clearance, and the segment is clipped against it.
+ *
+ * @param[in] start Segment start, along and to the left of the mouse heading.
+ * @param[in] end Segment end, along and to the left of the mouse heading.
+ *
+ * @return Whether the segment crosses the footprint.
+ */
+static bool crosses_footprint(float *start, float *end)
+{
+	int i;
+	float delta;
+	float near;
+	float far;
+	float swap;
+	float enter = 0.;
+	float leave = 1.;
+	float margin = WALL_WIDTH / 2 + SWEEP_CLEARANCE;
+	float lower[2] = {-MOUSE_TAIL - margin, -MOUSE_WIDTH / 2 - margin};
+	float upper[2] = {MOUSE_HEAD + margin, MOUSE_WIDTH / 2 + margin};
+
+	for (i = 0; i < 2; i++) {
+		delta = end[i] - start[i];
+		if (delta == 0.) {
+			if (start[i] < lower[i] || start[i] > upper[i])
+				return false;
+			continue;
+		}
+		near = (lower[i] - start[i]) / delta;
+		far = (upper[i] - start[i]) / delta;
+		if (near > far) {
+			swap = near;
+			near = far;
+			far = swap;
+		}
+		if (near > enter)
+			enter = near;
+		if (far < leave)
+			leave = far;
+		if (enter > leave)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Check whether a maze segment, a wall or a post, hits the mouse.
+ *
+ * @param[in] pose Mouse pose.
+ * @param[in] cosine Cosine of the mouse orientation.
+ * @param[in] sine Sine of the mouse orientation.
+ * @param[in] x0 Segment start X coordinate, in meters.
+ * @param[in] y0 Segment start Y coordinate, in meters.
+ * @param[in] x1 Segment end X coordinate, in meters.
+ * @param[in] y1 Segment end Y coordinate, in meters.
+ *
+ * @return Whether the segment hits the mouse.
+ */
+static bool hits_mouse(struct pose *pose, float cosine, float sine, float x0,
+		       float y0, float x1, float y1)
+{
+	float start[2];
+	float end[2];
+
+	x0 -= pose->x;
+	y0 -= pose->y;
+	x1 -= pose->x;
+	y1 -= pose->y;
+	start[0] = x0 * cosine + y0 * sine;
+	start[1] = y0 * cosine - x0 * sine;
+	end[0] = x1 * cosine + y1 * sine;
+	end[1] = y1 * cosine - x1 * sine;
+	return crosses_footprint(start, end);
+}
+
+/**
+ * @brief Check whether the mouse keeps clear of posts and known walls.
+ *
+ * Only the cell where the mouse is and its neighbors are checked, as nothing
+ * else is within reach.
+ *
+ * @param[in] pose Mouse pose.
+ *
+ * @return Whether the mouse is clear.
+ */
+static bool pose_is_clear(struct pose *pose)
+{
+	int dx;
+	int dy;
+	int column;
+	int row;
+	uint8_t cell;
+	uint8_t walls;
+	float x;
+	float y;
+	float cosine = cosf(pose->theta);
+	float sine = sinf(pose->theta);
+
+	if (!find_pose_cell(pose, &cell))
+		return false;
+	column = cell % MAZE_SIZE;
+	row = cell / MAZE_SIZE;
+	for (dx = 0; dx < 2; dx++) {
+		for (dy = 0; dy < 2; dy++) {
+			x = (column + dx) * CELL_DIMENSION;
+			y = (row + dy) * CELL_DIMENSION;
+			if (hits_mouse(pose, cosine, sine, x, y, x, y))
+				return false;
+		}
+	}
+	for (dx = -1; dx < 2; dx++) {
+		for (dy = -1; dy < 2; dy++) {
+			if (column + dx < 0 || column + dx >= MAZE_SIZE ||
+			    row + dy < 0 || row + dy >= MAZE_SIZE)
+				continue;
+			walls = read_cell_walls_value((row + dy) * MAZE_SIZE +
+						      column + dx);
+			x = (column + dx) * CELL_DIMENSION;
+			y = (row + dy) * CELL_DIMENSION;
+			if ((walls & EAST_BIT) &&
+			    hits_mouse(pose, cosine, sine, x + CELL_DIMENSION,
+				       y, x + CELL_DIMENSION,
+				       y + CELL_DIMENSION))
+				return false;
+			if ((walls & SOUTH_BIT) &&
+			    hits_mouse(pose, cosine, sine, x, y,
+				       x + CELL_DIMENSION, y))
+				return false;
+			if ((walls & WEST_BIT) &&
+			    hits_mouse(pose, cosine, sine, x, y, x,
+				       y + CELL_DIMENSION))
+				return false;
+			if ((walls & NORTH_BIT) &&
+			    hits_mouse(pose, cosine, sine, x,
+				       y + CELL_DIMENSION, x + CELL_DIMENSION,
+				       y + CELL_DIMENSION))
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Move the mouse pose along its heading, without sweeping.
+ *
+ * @param[in,out] pose Mouse pose.
+ * @param[in] distance Distance to move, in meters.
+ */
+static void move_pose(struct pose *pose, float distance)
+{
+	pose->x += distance * cosf(pose->theta);
+	pose->y += distance * sinf(pose->theta);
+}
+
+/**
+ * @brief Sweep the mouse along a straight line.
+ *
+ * Negative distances move the pose back without sweeping.
+ *
+ * @param[in,out] pose Mouse pose.
+ * @param[in] distance Distance to travel, in meters.
+ *
+ * @return Whether the swept area is clear.
+ */
+static bool sweep_straight(struct pose *pose, float distance)
+{
+	float step;
+	float travelled;
+
+	if (distance < 0.) {
+		move_pose(pose, distance);
+		return true;
+	}
+	for (travelled = 0.; travelled < distance; travelled += step) {
+		step = distance - travelled;
+		if (step > SWEEP_STEP)
+			step = SWEEP_STEP;
+		move_pose(pose, step);
+		if (!pose_is_clear(pose))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Sweep the mouse along a speed turn.
+ *
+ * @param[in,out] pose Mouse pose.
+ * @param[in] turn Turn type.
+ *
+ * @return Whether the swept area is clear.
+ */
+static bool sweep_turn(struct pose *pose, enum movement turn)
+{
+	float step;
+	float travelled;
+	float curvature;
+	float length = get_move_turn_length(turn);
+
+	for (travelled = 0.; travelled < length; travelled += step) {
+		step = length - travelled;
+		if (step > SWEEP_STEP)
+			step = SWEEP_STEP;
+		curvature = get_move_turn_curvature(turn, travelled + step / 2);
+		pose->theta -= curvature * step / 2;
+		move_pose(pose, step);
+		pose->theta -= curvature * step / 2;
+		if (!pose_is_clear(pose))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Find the first smooth path segment that does not keep clear.
+ *
+ * The path is swept as it would be executed, from the entry edge of the
+ * starting cell, checking the mouse footprint against the posts and the known
+ * walls of the maze. Turn geometry comes from the speed turn parameters.
+ *
+ * A straight line that is not clear is reported at the movement that closes
+ * it, as it is usually that turn cutting too close to a post.
+ *
+ * @param[in] path Smooth path segments to check.
+ * @param[in] cell Starting cell.
+ * @param[in] direction Starting direction.
+ *
+ * @return The index of the first unsafe segment, or -1 if the path is safe.
+ */
+int find_unsafe_segment(struct path_segment *path, uint8_t cell,
+			enum compass_direction direction)
+{
+	int i;
+	float distance = 0.;
+	struct pose pose;
+
+	make_cell_pose(&pose, cell, direction, 0.);
+
+	for (i = 0; path[i].movement != MOVE_END; i++) {
+		switch (path[i].movement) {
+		case MOVE_START:
+			/* Leave the starting dead end without sweeping */
+			move_pose(&pose, CELL_DIMENSION);
+			distance = -CELL_DIMENSION;
+			break;
+		case MOVE_FRONT:
+			distance += path[i].count * CELL_DIMENSION;
+			break;
+		case MOVE_DIAGONAL:
+			distance += path[i].count * CELL_DIAGONAL;
+			break;
+		case MOVE_STOP:
+			distance -= CELL_DIMENSION / 2;
+			if (!sweep_straight(&pose, distance))
+				return i;
+			distance = 0.;
+			break;
+		default:
+			distance += get_move_turn_before(path[i].movement);
+			if (!sweep_straight(&pose, distance))
+				return i;
+			if (!sweep_turn(&pose, path[i].movement))
+				return i;
+			distance = get_move_turn_after(path[i].movement);
+			break;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,16 @@
+#ifndef __CLEARANCE_H
+#define __CLEARANCE_H
+
+#include <math.h>
+
+#include "mmlib/path.h"
+#include "mmlib/pose.h"
+#include "mmlib/search.h"
+#include "mmlib/speed.h"
+
+#include "config.h"
+
+int find_unsafe_segment(struct path_segment *path, uint8_t cell,
+			enum compass_direction direction);
+
+#endif /* __CLEARANCE_H */
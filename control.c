@@ -2,13 +2,9 @@
 
 static volatile float target_linear_speed;
 static volatile float ideal_linear_speed;
+static volatile float ideal_linear_acceleration;
 static volatile float ideal_angular_speed;
 
-static volatile float linear_error;
-static volatile float angular_error;
-static volatile float last_linear_error;
-static volatile float last_angular_error;
-
 static volatile float voltage_left;
 static volatile float voltage_right;
 static volatile int32_t pwm_left;
@@ -20,10 +16,155 @@ static volatile bool side_sensors_close_control_enabled;
 static volatile bool side_sensors_far_control_enabled;
 static volatile bool front_sensors_control_enabled;
 static volatile bool diagonal_sensors_control_enabled;
+
+#ifdef MMLIB_FIXED_POINT_CONTROL
+/* Fractional bits of the fixed point control values (Q16.16) */
+#define FIXED_POINT_BITS 16
+/* Control ticks between refreshes of the cached driver voltage and gains */
+#define FIXED_POINT_REFRESH_TICKS 16
+
+static volatile int32_t linear_error;
+static volatile int32_t angular_error;
+static volatile int32_t last_linear_error;
+static volatile int32_t last_angular_error;
+static volatile int32_t side_sensors_integral;
+static volatile int32_t front_sensors_integral;
+static volatile int32_t diagonal_sensors_integral;
+
+/**
+ * @brief Cached fixed point control constants.
+ *
+ * - Control gains, converted from the current control constants.
+ * - PWM duty for each volt, the reciprocal of the driver input voltage.
+ * - Control ticks left before the next refresh.
+ */
+static struct fixed_control_constants {
+	int32_t kp_linear;
+	int32_t kd_linear;
+	int32_t kp_angular;
+	int32_t kd_angular;
+	int32_t kp_angular_side;
+	int32_t kp_angular_front;
+	int32_t kp_angular_diagonal;
+	int32_t ki_angular_side;
+	int32_t ki_angular_front;
+	int32_t ki_angular_diagonal;
+	int32_t pwm_per_volt;
+	uint32_t countdown;
+} fixed;
+#else
+static volatile float linear_error;
+static volatile float angular_error;
+static volatile float last_linear_error;
+static volatile float last_angular_error;
 static volatile float side_sensors_integral;
 static volatile float front_sensors_integral;
 static volatile float diagonal_sensors_integral;
+#endif
 
+#ifdef MMLIB_FIXED_POINT_CONTROL
+/**
+ * @brief Saturate a 64-bit intermediate result to a 32-bit fixed point value.
+ */
+static int32_t fixed_saturate(int64_t value)
+{
+	if (value > INT32_MAX)
+		return INT32_MAX;
+	if (value < INT32_MIN)
+		return INT32_MIN;
+	return (int32_t)value;
+}
+
+/**
+ * @brief Convert a floating point value to fixed point, saturating.
+ */
+static int32_t to_fixed(float value)
+{
+	value *= 1 << FIXED_POINT_BITS;
+	if (value >= (float)INT32_MAX)
+		return INT32_MAX;
+	if (value <= (float)INT32_MIN)
+		return INT32_MIN;
+	return (int32_t)value;
+}
+
+/**
+ * @brief Convert a fixed point value to floating point.
+ */
+static float to_float(int32_t value)
+{
+	return (float)value / (1 << FIXED_POINT_BITS);
+}
+
+/**
+ * @brief Add two fixed point values, saturating.
+ */
+static int32_t fixed_add(int32_t a, int32_t b)
+{
+	return fixed_saturate((int64_t)a + b);
+}
+
+/**
+ * @brief Subtract two fixed point values, saturating.
+ */
+static int32_t fixed_subtract(int32_t a, int32_t b)
+{
+	return fixed_saturate((int64_t)a - b);
+}
+
+/**
+ * @brief Multiply two fixed point values and accumulate, saturating.
+ *
+ * @param[in] accumulator Value to add the product to.
+ * @param[in] gain First factor, usually a control gain.
+ * @param[in] value Second factor.
+ */
+static int32_t fixed_multiply_add(int32_t accumulator, int32_t gain,
+				  int32_t value)
+{
+	return fixed_saturate(accumulator +
+			      (((int64_t)gain * value) >> FIXED_POINT_BITS));
+}
+
+/**
+ * @brief Refresh the cached fixed point control constants.
+ *
+ * The driver input voltage reciprocal is cached, so no division is needed on
+ * each control tick. Gains are converted here too, which picks up any change
+ * made to the control constants.
+ */
+static void refresh_fixed_control_constants(void)
+{
+	struct control_constants control = get_control_constants();
+
+	fixed.kp_linear = to_fixed(control.kp_linear);
+	fixed.kd_linear = to_fixed(control.kd_linear);
+	fixed.kp_angular = to_fixed(control.kp_angular);
+	fixed.kd_angular = to_fixed(control.kd_angular);
+	fixed.kp_angular_side = to_fixed(control.kp_angular_side);
+	fixed.kp_angular_front = to_fixed(control.kp_angular_front);
+	fixed.kp_angular_diagonal = to_fixed(control.kp_angular_diagonal);
+	fixed.ki_angular_side = to_fixed(control.ki_angular_side);
+	fixed.ki_angular_front = to_fixed(control.ki_angular_front);
+	fixed.ki_angular_diagonal = to_fixed(control.ki_angular_diagonal);
+	fixed.pwm_per_volt =
+	    to_fixed(DRIVER_PWM_PERIOD / get_motor_driver_input_voltage());
+	fixed.countdown = FIXED_POINT_REFRESH_TICKS;
+}
+
+/**
+ * @brief Convert a fixed point voltage to its corresponding motor PWM duty.
+ *
+ * Uses the cached driver input voltage reciprocal.
+ *
+ * @param[in] voltage Voltage to convert, in fixed point.
+ */
+static int32_t fixed_voltage_to_motor_pwm(int32_t voltage)
+{
+	return fixed_saturate(((int64_t)voltage * fixed.pwm_per_volt) >>
+			      (2 * FIXED_POINT_BITS));
+}
+#else
 /**
  * @brief Convert a given voltage to its corresponding motor PWM duty.
  *
@@ -38,6 +179,7 @@ static int32_t voltage_to_motor_pwm(float voltage)
 {
 	return voltage / get_motor_driver_input_voltage() * DRIVER_PWM_PERIOD;
 }
+#endif
 
 /**
  * @brief Enable or disable the side sensors close control.
@@ -86,11 +228,15 @@ void disable_walls_control(void)
  * @brief Set collision detected signal.
  *
  * It also automatically disables the motor control.
+ *
+ * Besides the control loop, it is used to flag collisions the mouse could not
+ * recover from.
  */
-static void set_collision_detected(void)
+void set_collision_detected(void)
 {
 	collision_detected_signal = true;
 	motor_control_enabled_signal = false;
+	reset_motion_queue();
 }
 
 /**
@@ -125,6 +271,9 @@ void reset_control_errors(void)
 	angular_error = 0;
 	last_linear_error = 0;
 	last_angular_error = 0;
+#ifdef MMLIB_FIXED_POINT_CONTROL
+	fixed.countdown = 0;
+#endif
 }
 
 /**
@@ -134,6 +283,7 @@ void reset_control_speed(void)
 {
 	target_linear_speed = 0.;
 	ideal_linear_speed = 0.;
+	ideal_linear_acceleration = 0.;
 	ideal_angular_speed = 0.;
 }
 
@@ -182,6 +332,7 @@ void disable_motor_control(void)
  * - Disable walls control.
  * - Turn the motor driver off.
  * - Reset control state.
+ * - Drop any queued motion segment.
  */
 void reset_motion(void)
 {
@@ -189,6 +340,7 @@ void reset_motion(void)
 	disable_walls_control();
 	drive_off();
 	reset_control_all();
+	reset_motion_queue();
 }
 
 /**
@@ -239,6 +391,17 @@ float get_ideal_linear_speed(void)
 	return ideal_linear_speed;
 }
 
+/**
+ * @brief Return the current ideal linear acceleration in meters per second
+ * squared.
+ *
+ * It is always zero unless a jerk-limited profile is being used.
+ */
+float get_ideal_linear_acceleration(void)
+{
+	return ideal_linear_acceleration;
+}
+
 /**
  * @brief Return the current ideal angular speed in radians per second.
  */
@@ -279,14 +442,60 @@ void set_ideal_angular_speed(float speed)
 	ideal_angular_speed = speed;
 }
 
+/**
+ * @brief Update ideal linear speed following a jerk-limited profile.
+ *
+ * The ideal acceleration changes at most by the given jerk, so the speed
+ * follows an S-curve. It is also limited so that it can be ramped down to zero
+ * right when reaching the target speed.
+ *
+ * @param[in] jerk Maximum linear jerk, in meters per second cubed.
+ */
+static void update_jerk_limited_linear_speed(float jerk)
+{
+	float error = target_linear_speed - ideal_linear_speed;
+	float direction;
+	float limit;
+	float magnitude;
+	float braking;
+
+	if (error == 0.) {
+		ideal_linear_acceleration = 0.;
+		return;
+	}
+	direction = error > 0. ? 1. : -1.;
+	limit = error > 0. ? get_linear_acceleration()
+			   : get_linear_deceleration();
+	magnitude = ideal_linear_acceleration * direction +
+		    jerk / SYSTICK_FREQUENCY_HZ;
+	if (magnitude > limit)
+		magnitude = limit;
+	braking = sqrtf(2 * jerk * fabsf(error));
+	if (magnitude > braking)
+		magnitude = braking;
+	ideal_linear_acceleration = direction * magnitude;
+	ideal_linear_speed += ideal_linear_acceleration / SYSTICK_FREQUENCY_HZ;
+	if ((target_linear_speed - ideal_linear_speed) * direction <= 0.) {
+		ideal_linear_speed = target_linear_speed;
+		ideal_linear_acceleration = 0.;
+	}
+}
+
 /**
  * @brief Update ideal linear speed according to the defined speed profile.
  *
  * Current ideal speed is increased or decreased according to the target speed
- * and the defined maximum acceleration and deceleration.
+ * and the defined maximum acceleration and deceleration. If a maximum linear
+ * jerk is defined, the acceleration is also smoothed (S-curve profile).
  */
 void update_ideal_linear_speed(void)
 {
+	float jerk = get_linear_jerk();
+
+	if (jerk > 0.) {
+		update_jerk_limited_linear_speed(jerk);
+		return;
+	}
 	if (ideal_linear_speed < target_linear_speed) {
 		ideal_linear_speed +=
 		    get_linear_acceleration() / SYSTICK_FREQUENCY_HZ;
@@ -300,16 +509,103 @@ void update_ideal_linear_speed(void)
 	}
 }
 
+#ifdef MMLIB_FIXED_POINT_CONTROL
 /**
- * @brief Execute the robot motor control.
+ * @brief Compute the motors PWM duty with fixed point arithmetic.
  *
- * Set the motors power to try to follow a defined speed profile.
- *
- * This function also implements collision detection by checking PWM output
- * saturation. If collision is detected it sets the `collision_detected_signal`
- * variable to `true`.
+ * Control errors, integrals and gains are kept in Q16.16 fixed point with
+ * saturating arithmetic. Volatile state is only read and written once.
  */
-void motor_control(void)
+static void update_motor_pwm(void)
+{
+	int32_t side_feedback = 0;
+	int32_t far_feedback;
+	int32_t front_feedback = 0;
+	int32_t diagonal_feedback = 0;
+	int32_t side_integral = side_sensors_integral;
+	int32_t front_integral = front_sensors_integral;
+	int32_t diagonal_integral = diagonal_sensors_integral;
+	int32_t linear = linear_error;
+	int32_t angular = angular_error;
+	int32_t linear_voltage;
+	int32_t angular_voltage;
+	int32_t left;
+	int32_t right;
+
+	if (fixed.countdown == 0)
+		refresh_fixed_control_constants();
+	fixed.countdown--;
+
+	if (side_sensors_close_control_enabled) {
+		side_feedback = to_fixed(get_side_sensors_close_error());
+		side_integral = fixed_add(side_integral, side_feedback);
+	}
+
+	if (side_sensors_far_control_enabled) {
+		far_feedback = to_fixed(get_side_sensors_far_error());
+		side_feedback = fixed_add(side_feedback, far_feedback);
+		side_integral = fixed_add(side_integral, side_feedback);
+	}
+
+	if (front_sensors_control_enabled) {
+		front_feedback = to_fixed(get_front_sensors_error());
+		front_integral = fixed_add(front_integral, front_feedback);
+	}
+
+	if (diagonal_sensors_control_enabled) {
+		diagonal_feedback = to_fixed(get_diagonal_sensors_error());
+		diagonal_integral =
+		    fixed_add(diagonal_integral, diagonal_feedback);
+	}
+
+	linear = fixed_add(
+	    linear, fixed_subtract(to_fixed(ideal_linear_speed),
+				   to_fixed(get_measured_linear_speed())));
+	angular = fixed_add(
+	    angular, fixed_subtract(to_fixed(ideal_angular_speed),
+				    to_fixed(get_measured_angular_speed())));
+
+	linear_voltage = fixed_multiply_add(0, fixed.kp_linear, linear);
+	linear_voltage = fixed_multiply_add(
+	    linear_voltage, fixed.kd_linear,
+	    fixed_subtract(linear, last_linear_error));
+	angular_voltage = fixed_multiply_add(0, fixed.kp_angular, angular);
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.kd_angular,
+	    fixed_subtract(angular, last_angular_error));
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.kp_angular_side, side_feedback);
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.kp_angular_front, front_feedback);
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.kp_angular_diagonal, diagonal_feedback);
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.ki_angular_side, side_integral);
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.ki_angular_front, front_integral);
+	angular_voltage = fixed_multiply_add(
+	    angular_voltage, fixed.ki_angular_diagonal, diagonal_integral);
+
+	left = fixed_add(linear_voltage, angular_voltage);
+	right = fixed_subtract(linear_voltage, angular_voltage);
+	voltage_left = to_float(left);
+	voltage_right = to_float(right);
+	pwm_left = fixed_voltage_to_motor_pwm(left);
+	pwm_right = fixed_voltage_to_motor_pwm(right);
+
+	side_sensors_integral = side_integral;
+	front_sensors_integral = front_integral;
+	diagonal_sensors_integral = diagonal_integral;
+	linear_error = linear;
+	angular_error = angular;
+	last_linear_error = linear;
+	last_angular_error = angular;
+}
+#else
+/**
+ * @brief Compute the motors PWM duty with floating point arithmetic.
+ */
+static void update_motor_pwm(void)
 {
 	float linear_voltage;
 	float angular_voltage;
@@ -318,11 +614,6 @@ void motor_control(void)
 	float diagonal_sensors_feedback = 0.;
 	struct control_constants control;
 
-	if (!motor_control_enabled_signal)
-		return;
-
-	update_ideal_linear_speed();
-
 	if (side_sensors_close_control_enabled) {
 		side_sensors_feedback += get_side_sensors_close_error();
 		side_sensors_integral += side_sensors_feedback;
@@ -365,11 +656,37 @@ void motor_control(void)
 	pwm_left = voltage_to_motor_pwm(voltage_left);
 	pwm_right = voltage_to_motor_pwm(voltage_right);
 
-	power_left(pwm_left);
-	power_right(pwm_right);
-
 	last_linear_error = linear_error;
 	last_angular_error = angular_error;
+}
+#endif
+
+/**
+ * @brief Execute the robot motor control.
+ *
+ * Set the motors power to try to follow a defined speed profile. The pose
+ * estimation is updated first, even if motor control is disabled.
+ *
+ * The control loop uses floating point arithmetic, unless
+ * `MMLIB_FIXED_POINT_CONTROL` is defined at compile time, in which case it
+ * uses saturating fixed point arithmetic instead.
+ *
+ * This function also implements collision detection by checking PWM output
+ * saturation. If collision is detected it sets the `collision_detected_signal`
+ * variable to `true`.
+ */
+void motor_control(void)
+{
+	update_pose();
+	if (!motor_control_enabled_signal)
+		return;
+
+	motion_control();
+	update_ideal_linear_speed();
+	update_motor_pwm();
+
+	power_left(pwm_left);
+	power_right(pwm_right);
 
 	if (motor_driver_saturation() >
 	    MAX_MOTOR_DRIVER_SATURATION_PERIOD * SYSTICK_FREQUENCY_HZ)
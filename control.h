@@ -3,6 +3,8 @@
 
 #include "mmlib/encoder.h"
 #include "mmlib/hmi.h"
+#include "mmlib/motion.h"
+#include "mmlib/pose.h"
 #include "mmlib/speed.h"
 #include "mmlib/walls.h"
 
@@ -16,6 +18,7 @@ void front_sensors_control(bool value);
 void diagonal_sensors_control(bool value);
 void enable_walls_control(void);
 void disable_walls_control(void);
+void set_collision_detected(void);
 bool collision_detected(void);
 void reset_collision_detection(void);
 void reset_control_errors(void);
@@ -30,6 +33,7 @@ int32_t get_left_pwm(void);
 int32_t get_right_pwm(void);
 float get_target_linear_speed(void);
 float get_ideal_linear_speed(void);
+float get_ideal_linear_acceleration(void);
 float get_ideal_angular_speed(void);
 float get_measured_linear_speed(void);
 float get_measured_angular_speed(void);
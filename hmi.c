@@ -191,6 +191,29 @@ void configure_solver_direction(void)
 	}
 }
 
+/**
+ * @brief Select the exploration strategy for the solver.
+ *
+ * Each short click selects the next strategy (starting with the default one
+ * and wrapping around), a long click confirms the selection.
+ */
+void configure_exploration_strategy(void)
+{
+	uint8_t strategy = EXPLORATION_DEFAULT;
+
+	while (1) {
+		switch (button_user_wait_action()) {
+		case BUTTON_SHORT:
+			strategy += 1;
+			strategy %= EXPLORATION_STRATEGIES_COUNT;
+			break;
+		case BUTTON_LONG:
+			set_exploration_strategy(strategy);
+			return;
+		}
+	}
+}
+
 /**
  * @brief Select a force level for exploration or run phases.
  *
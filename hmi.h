@@ -22,6 +22,7 @@ enum button_response button_user_response(void);
 enum button_action button_user_wait_action(void);
 void wait_front_sensor_close_signal(float close_distance);
 void configure_solver_direction(void);
+void configure_exploration_strategy(void);
 float hmi_configure_force(float minimum_force, float force_step);
 
 #endif /* __HMI_H */
@@ -0,0 +1,541 @@
+#include "motion.h"
+
+/* In-place turn angular velocity for each radian left to turn, in hertz */
+#define INPLACE_TURN_GAIN 150.f
+/* Heading error at which in-place turns finish, in radians */
+#define INPLACE_TURN_TOLERANCE 0.002f
+/* Maximum in-place turn duration, relative to the planned duration */
+#define INPLACE_TURN_TIMEOUT 2.f
+
+/* Speed turn curvature correction for each meter of lateral error, in m^-2 */
+#define SPEED_TURN_LATERAL_GAIN 200.f
+/* Speed turn curvature correction for each radian of heading error, in m^-1 */
+#define SPEED_TURN_HEADING_GAIN 28.f
+
+/* Front wall alignment speed for each meter of distance error, in hertz */
+#define FRONT_ALIGN_GAIN 20.f
+/* Maximum front wall alignment speed, in meters per second */
+#define FRONT_ALIGN_MAX_SPEED 0.3f
+/* Weight of each new front wall distance error sample in its average */
+#define FRONT_ALIGN_FILTER 0.2f
+/* Ticks both errors must stay within tolerance to finish the alignment */
+#define FRONT_ALIGN_SETTLE_TICKS 10
+/* Maximum front wall alignment duration, in ticks */
+#define FRONT_ALIGN_TIMEOUT_TICKS SYSTICK_FREQUENCY_HZ
+
+/* Maximum wait for room in the motion queue, in ticks */
+#define MOTION_QUEUE_TIMEOUT_TICKS SYSTICK_FREQUENCY_HZ
+
+enum motion_phase {
+	MOTION_CRUISE,
+	MOTION_BRAKE,
+};
+
+/**
+ * Motion queue, written from the main loop and read from the control tick.
+ */
+static volatile struct motion_queue {
+	struct motion_segment segments[MOTION_QUEUE_LEN];
+	uint8_t head;
+	uint8_t tail;
+} queue;
+
+/**
+ * State of the motion segment being executed.
+ *
+ * - Whether the segment has started.
+ * - Current phase, for straight segments.
+ * - Starting point, in micrometers or ticks.
+ * - Target point, in micrometers.
+ * - Point where the diagonal sensors control stops, in micrometers.
+ * - Maximum angular velocity of in-place turns, or maximum curvature of speed
+ *   turns.
+ * - Duration of the turn transition phases, in meters or seconds.
+ * - Duration of the turn constant angular velocity phase.
+ * - Angle to turn in place, in radians.
+ * - Angle turned during each in-place turn transition phase, in radians.
+ * - Gyroscope integrated angle when the in-place turn started, in degrees.
+ * - Filtered front wall distance error, in meters.
+ * - Consecutive ticks aligned with the front wall.
+ * - Reference pose along speed turns.
+ * - Reference orientation cosine and sine, rotated incrementally.
+ * - Point up to which the reference pose has been integrated, in micrometers.
+ */
+static struct motion_state {
+	bool started;
+	enum motion_phase phase;
+	int32_t start;
+	int32_t target;
+	int32_t control_target;
+	float velocity;
+	float transition;
+	float arc;
+	float angle;
+	float transition_angle;
+	float heading;
+	float error;
+	uint32_t settled;
+	struct pose reference;
+	float reference_cosine;
+	float reference_sine;
+	int32_t referenced;
+} state;
+
+/**
+ * @brief Check whether a segment can be pushed, or will never be.
+ *
+ * A collision stops the motion control and drops the queued segments, so
+ * there is no point in waiting for room after that.
+ */
+static bool _motion_queue_ready(void)
+{
+	return !motion_queue_full() || collision_detected();
+}
+
+/**
+ * @brief Push a segment to the motion queue.
+ *
+ * It waits for the control tick to make room in the queue, if it is full.
+ * Segments are not pushed after a collision, as they would not be executed.
+ *
+ * @param[in] segment Motion segment to push.
+ *
+ * @return Whether the segment was pushed, false on collision or if the queue
+ * stayed full.
+ */
+bool push_motion(struct motion_segment *segment)
+{
+	uint8_t head;
+
+	if (!wait_until(_motion_queue_ready, MOTION_QUEUE_TIMEOUT_TICKS)) {
+		LOG_ERROR("Motion queue full!");
+		return false;
+	}
+	if (collision_detected())
+		return false;
+	head = queue.head;
+	queue.segments[head] = *segment;
+	queue.head = (head + 1) % MOTION_QUEUE_LEN;
+	return true;
+}
+
+/**
+ * @brief Push a straight segment to the motion queue.
+ *
+ * @param[in] distance Distance to travel, in meters.
+ * @param[in] end_speed Speed at the end of the segment, in meters per second.
+ * @param[in] control Sensors control to enable (`MOTION_*_CONTROL` flags).
+ *
+ * @return Whether the segment was pushed.
+ */
+bool push_motion_straight(float distance, float end_speed, uint8_t control)
+{
+	struct motion_segment segment = {0};
+
+	segment.type = MOTION_STRAIGHT;
+	segment.control = control;
+	segment.distance = distance;
+	segment.end_speed = end_speed;
+	return push_motion(&segment);
+}
+
+/**
+ * @brief Push a speed turn segment to the motion queue.
+ *
+ * @param[in] turn Turn type.
+ * @param[in] speed Linear speed at which to turn, in meters per second.
+ *
+ * @return Whether the segment was pushed.
+ */
+bool push_motion_turn(enum movement turn, float speed)
+{
+	struct motion_segment segment = {0};
+
+	segment.type = MOTION_SPEED_TURN;
+	segment.control = MOTION_KEEP_CONTROL;
+	segment.turn = turn;
+	segment.end_speed = speed;
+	return push_motion(&segment);
+}
+
+/**
+ * @brief Check whether the motion queue is full.
+ */
+bool motion_queue_full(void)
+{
+	return (queue.head + 1) % MOTION_QUEUE_LEN == queue.tail;
+}
+
+/**
+ * @brief Check whether all the queued motion segments have been executed.
+ */
+bool motion_idle(void)
+{
+	return queue.head == queue.tail;
+}
+
+/**
+ * @brief Wait until all the queued motion segments have been executed.
+ */
+void wait_motion_idle(void)
+{
+	while (!motion_idle())
+		;
+}
+
+/**
+ * @brief Drop all the queued motion segments.
+ */
+void reset_motion_queue(void)
+{
+	queue.tail = queue.head;
+	state.started = false;
+}
+
+/**
+ * @brief Apply the sensors control flags of a motion segment.
+ *
+ * @param[in] control Sensors control flags.
+ */
+static void apply_sensors_control(uint8_t control)
+{
+	if (control == MOTION_KEEP_CONTROL)
+		return;
+	side_sensors_close_control(control & MOTION_SIDE_CLOSE_CONTROL);
+	side_sensors_far_control(control & MOTION_SIDE_FAR_CONTROL);
+	front_sensors_control(control & MOTION_FRONT_CONTROL);
+	diagonal_sensors_control(control & MOTION_DIAGONAL_CONTROL);
+}
+
+/**
+ * @brief Prepare an in-place turn profile.
+ *
+ * @param[in] radians Radians to turn (positive means left).
+ * @param[in] force Maximum force to apply while turning.
+ */
+static void start_inplace_turn(float radians, float force)
+{
+	int turn_sign;
+	float angular_acceleration;
+	float max_angular_velocity;
+	float duration;
+	float transition_angle;
+
+	turn_sign = sign(radians);
+	radians = fabsf(radians);
+	angular_acceleration =
+	    force * MOUSE_WHEELS_SEPARATION / MOUSE_MOMENT_OF_INERTIA;
+	max_angular_velocity = sqrt(radians / 2 * angular_acceleration);
+	if (max_angular_velocity > MOUSE_MAX_ANGULAR_VELOCITY)
+		max_angular_velocity = MOUSE_MAX_ANGULAR_VELOCITY;
+
+	duration = max_angular_velocity / angular_acceleration * PI;
+	transition_angle = duration * max_angular_velocity / PI;
+	state.arc = (radians - 2 * transition_angle) / max_angular_velocity;
+	state.transition = duration / 2;
+	state.velocity = turn_sign * max_angular_velocity;
+	state.angle = radians;
+	state.transition_angle = transition_angle;
+	state.heading = get_gyro_z_degrees();
+
+	set_target_linear_speed(get_ideal_linear_speed());
+	disable_walls_control();
+	state.start = get_clock_ticks();
+}
+
+/**
+ * @brief Start executing a motion segment.
+ *
+ * @param[in] segment Motion segment to start.
+ */
+static void start_segment(volatile struct motion_segment *segment)
+{
+	float length;
+	int32_t start = get_encoder_average_micrometers();
+
+	state.started = true;
+	state.phase = MOTION_CRUISE;
+	apply_sensors_control(segment->control);
+	if (segment->anchored)
+		start = segment->start;
+	switch (segment->type) {
+	case MOTION_STRAIGHT:
+	case MOTION_DIAGONAL:
+		set_ideal_angular_speed(0.);
+		state.target = start + (int32_t)(segment->distance *
+						 MICROMETERS_PER_METER);
+		state.control_target =
+		    start + (int32_t)(segment->control_distance *
+				      MICROMETERS_PER_METER);
+		if (segment->type == MOTION_DIAGONAL)
+			diagonal_sensors_control(true);
+		if (segment->distance > 0)
+			set_target_linear_speed(get_max_linear_speed());
+		else
+			set_target_linear_speed(-get_max_linear_speed());
+		break;
+	case MOTION_SPEED_TURN:
+		length = get_move_turn_length(segment->turn);
+		state.velocity =
+		    get_move_turn_curvature(segment->turn, length / 2);
+		set_target_linear_speed(segment->end_speed);
+		disable_walls_control();
+		state.start = start;
+		state.target =
+		    start + (int32_t)(length * MICROMETERS_PER_METER);
+		state.reference = get_pose();
+		state.reference_cosine = cosf(state.reference.theta);
+		state.reference_sine = sinf(state.reference.theta);
+		state.referenced = start;
+		break;
+	case MOTION_INPLACE_TURN:
+		start_inplace_turn(segment->distance, segment->force);
+		break;
+	case MOTION_FRONT_ALIGN:
+		set_ideal_angular_speed(0.);
+		state.start = get_clock_ticks();
+		state.error = get_front_wall_distance() - segment->distance;
+		state.settled = 0;
+		break;
+	}
+}
+
+/**
+ * @brief Advance a straight motion segment.
+ *
+ * The target speed is kept at the maximum until the braking point, where it
+ * is set to the end speed. The target is corrected on every tick with the
+ * front wall distance, if requested and detected.
+ *
+ * @param[in] segment Motion segment being executed.
+ *
+ * @return Whether the segment is finished.
+ */
+static bool advance_straight(volatile struct motion_segment *segment)
+{
+	int32_t current = get_encoder_average_micrometers();
+	int32_t braking;
+	float correction;
+
+	if (segment->type == MOTION_DIAGONAL && current > state.control_target)
+		diagonal_sensors_control(false);
+	if (segment->front_wall_distance > 0.f && front_wall_detection()) {
+		correction =
+		    get_front_wall_distance() - segment->front_wall_distance;
+		state.target =
+		    current + (int32_t)(correction * MICROMETERS_PER_METER);
+	}
+	if (state.phase == MOTION_CRUISE) {
+		braking = state.target -
+			  required_micrometers_to_speed(segment->end_speed);
+		if (segment->distance > 0 && current < braking)
+			return false;
+		if (segment->distance <= 0 && current > braking)
+			return false;
+		set_target_linear_speed(segment->end_speed);
+		state.phase = MOTION_BRAKE;
+	}
+	if (segment->type == MOTION_STRAIGHT && segment->end_speed == 0.f)
+		return get_ideal_linear_speed() == 0.f;
+	return current >= state.target;
+}
+
+/**
+ * @brief Get the curvature correction to track the reference of a speed turn.
+ *
+ * The reference pose is integrated along the ideal turn curvature, starting
+ * from the estimated pose at the turn entry, and compared with the estimated
+ * pose. Only deviations within the turn are corrected, so any drift of the
+ * estimated pose before the turn does not affect it. As in `update_pose()`,
+ * the reference orientation is rotated incrementally.
+ *
+ * @param[in] curvature Ideal curvature at the current point, in radians per
+ * meter (negative means left).
+ * @param[in] current Current point, in micrometers.
+ *
+ * @return The curvature correction, in radians per meter.
+ */
+static float track_speed_turn(float curvature, int32_t current)
+{
+	float step;
+	float delta;
+	float cosine = state.reference_cosine;
+	float sine = state.reference_sine;
+	float norm;
+	float lateral;
+	float heading;
+	struct pose pose = get_pose();
+
+	step = (float)(current - state.referenced) / MICROMETERS_PER_METER;
+	state.referenced = current;
+	delta = -curvature * step;
+	state.reference.x += step * (cosine - sine * delta / 2);
+	state.reference.y += step * (sine + cosine * delta / 2);
+	state.reference.theta += delta;
+	cosine -= state.reference_sine * delta;
+	sine += state.reference_cosine * delta;
+	norm = 1.5f - (cosine * cosine + sine * sine) / 2;
+	cosine *= norm;
+	sine *= norm;
+	state.reference_cosine = cosine;
+	state.reference_sine = sine;
+
+	lateral = (pose.y - state.reference.y) * cosine -
+		  (pose.x - state.reference.x) * sine;
+	heading = sinf(pose.theta - state.reference.theta);
+	return SPEED_TURN_LATERAL_GAIN * lateral +
+	       SPEED_TURN_HEADING_GAIN * heading;
+}
+
+/**
+ * @brief Advance a speed turn motion segment.
+ *
+ * The angular velocity follows the turn curvature, scaled with the precomputed
+ * turn profile, at the current ideal linear speed. A corrective term keeps
+ * the estimated pose on the reference turn curve, so that deviations within
+ * the turn, like slip, are corrected without the walls control.
+ *
+ * @param[in] segment Motion segment being executed.
+ *
+ * @return Whether the segment is finished.
+ */
+static bool advance_speed_turn(volatile struct motion_segment *segment)
+{
+	int32_t current = get_encoder_average_micrometers();
+	float curvature;
+
+	if (current >= state.target) {
+		set_ideal_angular_speed(0);
+		return true;
+	}
+	curvature = state.velocity *
+		    get_move_turn_ramp(segment->turn, current - state.start);
+	curvature += track_speed_turn(curvature, current);
+	set_ideal_angular_speed(get_ideal_linear_speed() * curvature);
+	return false;
+}
+
+/**
+ * @brief Advance an in-place turn motion segment.
+ *
+ * The angular velocity ramps up in time, but ramps down with the angle left
+ * to turn, as measured by the gyroscope, following the same sine profile. The
+ * last part is a proportional correction that converges on the exact target
+ * heading, even after an overshoot, and the turn only finishes once the mouse
+ * is almost still.
+ *
+ * @return Whether the segment is finished.
+ */
+static bool advance_inplace_turn(void)
+{
+	float time;
+	float turned;
+	float remaining;
+	float factor;
+	float max_angular_velocity = fabsf(state.velocity);
+	float angular_velocity = max_angular_velocity;
+
+	time = (float)(get_clock_ticks() - state.start) / SYSTICK_FREQUENCY_HZ;
+	turned = (get_gyro_z_degrees() - state.heading) * PI / 180;
+	remaining = state.angle - sign(state.velocity) * turned;
+	if ((fabsf(remaining) < INPLACE_TURN_TOLERANCE &&
+	     fabsf(get_measured_angular_speed()) <
+		 INPLACE_TURN_GAIN * INPLACE_TURN_TOLERANCE) ||
+	    time > INPLACE_TURN_TIMEOUT * (2 * state.transition + state.arc)) {
+		set_ideal_angular_speed(0);
+		return true;
+	}
+	if (time < state.transition)
+		angular_velocity *= get_turn_ramp(time / state.transition);
+	factor = fabsf(remaining) / state.transition_angle;
+	if (factor < 1.f)
+		angular_velocity =
+		    fminf(angular_velocity,
+			  max_angular_velocity * sqrtf(factor * (2 - factor)));
+	angular_velocity =
+	    fminf(angular_velocity, INPLACE_TURN_GAIN * fabsf(remaining));
+	if (remaining < 0.f)
+		angular_velocity = -angular_velocity;
+	set_ideal_angular_speed(sign(state.velocity) * angular_velocity);
+	return false;
+}
+
+/**
+ * @brief Advance a front wall alignment motion segment.
+ *
+ * The linear speed servos the filtered front wall distance, slowing down along
+ * the braking curve as the error gets smaller, while the front sensors control
+ * servos the angle. It finishes when both errors stay within tolerance, with
+ * the mouse almost stopped, when the front wall is lost or on timeout.
+ *
+ * @param[in] segment Motion segment being executed.
+ *
+ * @return Whether the segment is finished.
+ */
+static bool advance_front_align(volatile struct motion_segment *segment)
+{
+	float error;
+	float speed;
+	float tolerance = KEEP_FRONT_DISTANCE_TOLERANCE;
+
+	if (!front_wall_detection() ||
+	    get_clock_ticks() - state.start > FRONT_ALIGN_TIMEOUT_TICKS) {
+		set_target_linear_speed(0.);
+		return true;
+	}
+	error = get_front_wall_distance() - segment->distance;
+	state.error += FRONT_ALIGN_FILTER * (error - state.error);
+	error = state.error;
+	if (fabsf(error) < tolerance &&
+	    fabsf(get_front_sensors_error()) < tolerance &&
+	    fabsf(get_ideal_linear_speed()) < FRONT_ALIGN_GAIN * tolerance)
+		state.settled++;
+	else
+		state.settled = 0;
+	if (state.settled >= FRONT_ALIGN_SETTLE_TICKS) {
+		set_target_linear_speed(0.);
+		return true;
+	}
+	speed = fminf(FRONT_ALIGN_GAIN * fabsf(error),
+		      sqrtf(2 * get_linear_deceleration() * fabsf(error)));
+	speed = fminf(speed, FRONT_ALIGN_MAX_SPEED);
+	set_target_linear_speed(error > 0.f ? speed : -speed);
+	return false;
+}
+
+/**
+ * @brief Advance the motion queue execution.
+ *
+ * To be called on every control tick, right before updating the ideal speed
+ * profile, so that the main loop is free while the mouse moves.
+ */
+void motion_control(void)
+{
+	bool finished = false;
+	volatile struct motion_segment *segment;
+
+	if (motion_idle())
+		return;
+	segment = &queue.segments[queue.tail];
+	if (!state.started)
+		start_segment(segment);
+	switch (segment->type) {
+	case MOTION_STRAIGHT:
+	case MOTION_DIAGONAL:
+		finished = advance_straight(segment);
+		break;
+	case MOTION_SPEED_TURN:
+		finished = advance_speed_turn(segment);
+		break;
+	case MOTION_INPLACE_TURN:
+		finished = advance_inplace_turn();
+		break;
+	case MOTION_FRONT_ALIGN:
+		finished = advance_front_align(segment);
+		break;
+	}
+	if (!finished)
+		return;
+	state.started = false;
+	queue.tail = (queue.tail + 1) % MOTION_QUEUE_LEN;
+}
@@ -0,0 +1,73 @@
+#ifndef __MOTION_H
+#define __MOTION_H
+
+#include <math.h>
+
+#include "mmlib/clock.h"
+#include "mmlib/common.h"
+#include "mmlib/control.h"
+#include "mmlib/encoder.h"
+#include "mmlib/path.h"
+#include "mmlib/speed.h"
+
+#include "config.h"
+
+#define MOTION_QUEUE_LEN 8
+
+/* Sensors control to enable when a motion segment starts */
+#define MOTION_SIDE_CLOSE_CONTROL 0x01
+#define MOTION_SIDE_FAR_CONTROL 0x02
+#define MOTION_FRONT_CONTROL 0x04
+#define MOTION_DIAGONAL_CONTROL 0x08
+#define MOTION_KEEP_CONTROL 0xFF
+
+enum motion_type {
+	MOTION_STRAIGHT,    /**< Straight line, with a braking profile */
+	MOTION_DIAGONAL,    /**< Straight diagonal line */
+	MOTION_SPEED_TURN,  /**< Speed turn, as defined in `turns[]` */
+	MOTION_INPLACE_TURN, /**< In-place turn */
+	MOTION_FRONT_ALIGN,  /**< Alignment with the front wall */
+};
+
+/**
+ * Motion segment.
+ *
+ * - Motion type.
+ * - Sensors control to enable when it starts (`MOTION_*_CONTROL` flags).
+ * - Whether the distance is measured from `start` instead of from the position
+ *   where the segment starts.
+ * - Starting point, in micrometers, if anchored.
+ * - Distance to travel, in meters (radians to turn for in-place turns, distance
+ *   to keep from the front wall for front wall alignments).
+ * - Distance with diagonal sensors control, in meters.
+ * - Speed at the end of the segment, in meters per second (speed at which to
+ *   turn for speed turns).
+ * - Speed turn type.
+ * - Maximum force to apply on the tires while turning in place.
+ * - Distance, in meters, at which straight segments should end from the front
+ *   wall, to correct their target on the fly when it is detected (zero to
+ *   disable).
+ */
+struct motion_segment {
+	enum motion_type type;
+	uint8_t control;
+	bool anchored;
+	int32_t start;
+	float distance;
+	float control_distance;
+	float end_speed;
+	enum movement turn;
+	float force;
+	float front_wall_distance;
+};
+
+bool push_motion(struct motion_segment *segment);
+bool push_motion_straight(float distance, float end_speed, uint8_t control);
+bool push_motion_turn(enum movement turn, float speed);
+bool motion_queue_full(void);
+bool motion_idle(void);
+void wait_motion_idle(void);
+void reset_motion_queue(void);
+void motion_control(void);
+
+#endif /* __MOTION_H */
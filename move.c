@@ -1,8 +1,11 @@
 #include "move.h"
 
+/* Distance to back off after a collision, in meters */
+#define COLLISION_BACK_OFF 0.03
+
 static int32_t current_cell_start_micrometers;
-/* Angular acceleration is defined in radians per second squared. */
-static float angular_acceleration;
+static struct path_translator search_translator = {PATH_SEARCH, 0};
+static float planned_speeds[MAX_SMOOTH_PATH_LEN];
 
 /**
  * @brief Return the current robot shift inside the cell, in meters.
@@ -33,10 +36,41 @@ static void _entered_next_cell(void)
 		    (int32_t)((get_front_wall_distance() - CELL_DIMENSION) *
 			      MICROMETERS_PER_METER);
 		current_cell_start_micrometers += front_wall_correction;
+		correct_pose_forward(
+		    -(float)front_wall_correction / MICROMETERS_PER_METER, 1.);
 	}
 	led_left_toggle();
 }
 
+/**
+ * @brief Learn from the position error measured at the exit of a turn.
+ *
+ * Only turns that exit on an orthogonal are measured, with the side walls
+ * and the front wall.
+ *
+ * @param[in] turn Turn type.
+ */
+static void _learn_turn_exit(enum movement turn)
+{
+	float offset;
+
+	switch (turn) {
+	case MOVE_LEFT_TO_45:
+	case MOVE_RIGHT_TO_45:
+	case MOVE_LEFT_TO_135:
+	case MOVE_RIGHT_TO_135:
+	case MOVE_LEFT_DIAGONAL:
+	case MOVE_RIGHT_DIAGONAL:
+		return;
+	default:
+		break;
+	}
+	if (get_side_walls_offset(&offset))
+		learn_move_turn_lateral(turn, offset);
+	if (front_wall_detection())
+		learn_move_turn_front_wall(turn, get_front_wall_distance());
+}
+
 /**
  * @brief Initialize mouse position.
  *
@@ -47,13 +81,67 @@ void set_starting_position(void)
 	current_cell_start_micrometers =
 	    get_encoder_average_micrometers() -
 	    MOUSE_START_SHIFT * MICROMETERS_PER_METER;
+	set_pose_in_cell(search_position(), search_direction(),
+			 MOUSE_START_SHIFT);
+}
+
+/**
+ * @brief Calculate the time a jerk-limited speed change takes, in seconds.
+ *
+ * The profile starts and ends with zero acceleration and it is symmetric, so
+ * the acceleration limit is only reached for large enough speed changes.
+ *
+ * @param[in] speed_change Absolute speed change, in meters per second.
+ * @param[in] acceleration Maximum absolute acceleration.
+ * @param[in] jerk Maximum linear jerk.
+ */
+static float _jerk_limited_time(float speed_change, float acceleration,
+				float jerk)
+{
+	if (speed_change * jerk >= acceleration * acceleration)
+		return speed_change / acceleration + acceleration / jerk;
+	return 2 * sqrt(speed_change / jerk);
+}
+
+/**
+ * @brief Calculate the distance a jerk-limited speed change takes, in meters.
+ *
+ * Takes into account the current ideal acceleration: if it opposes the speed
+ * change it has to be ramped down first, otherwise the profile is considered
+ * to be already started.
+ *
+ * @param[in] start_speed Current speed, in meters per second.
+ * @param[in] end_speed Target speed, in meters per second.
+ * @param[in] acceleration Maximum absolute acceleration.
+ * @param[in] jerk Maximum linear jerk.
+ */
+static float _jerk_limited_distance(float start_speed, float end_speed,
+				    float acceleration, float jerk)
+{
+	float direction = (end_speed > start_speed) ? 1. : -1.;
+	float current = get_ideal_linear_acceleration();
+	float distance = 0.;
+	float time = fabsf(current) / jerk;
+
+	if (current * direction < 0.) {
+		distance = start_speed * time + current * time * time / 2 +
+			   direction * jerk * time * time * time / 6;
+		start_speed += current * time / 2;
+	} else if (current != 0.) {
+		start_speed -= current * time / 2;
+		distance = -(start_speed * time +
+			     direction * jerk * time * time * time / 6);
+	}
+	time = _jerk_limited_time(fabsf(end_speed - start_speed), acceleration,
+				  jerk);
+	return distance + (start_speed + end_speed) / 2 * time;
 }
 
 /**
  * @brief Calculate the required micrometers to reach a given speed.
  *
  * This functions assumes the current speed is the target speed and takes into
- * account the configured linear deceleration.
+ * account the configured linear deceleration and jerk.
  *
  * @param[in] speed Target speed.
 
@@ -63,9 +151,15 @@ int32_t required_micrometers_to_speed(float speed)
 {
 	float acceleration;
 	float current_speed = get_ideal_linear_speed();
+	float jerk = get_linear_jerk();
 
 	acceleration = (current_speed > speed) ? -get_linear_deceleration()
 					       : get_linear_acceleration();
+	if (jerk > 0.)
+		return (int32_t)(_jerk_limited_distance(current_speed, speed,
+							fabsf(acceleration),
+							jerk) *
+				 MICROMETERS_PER_METER);
 
 	return (int32_t)((speed * speed - current_speed * current_speed) /
 			 (2 * acceleration) * MICROMETERS_PER_METER);
@@ -75,15 +169,19 @@ int32_t required_micrometers_to_speed(float speed)
  * @brief Calculate the required time to reach a given speed, in seconds.
  *
  * This functions assumes the current speed is the target speed and takes into
- * account the configured linear deceleration.
+ * account the configured linear deceleration and jerk.
  */
 float required_time_to_speed(float speed)
 {
 	float acceleration;
 	float target_speed = get_target_linear_speed();
+	float jerk = get_linear_jerk();
 
 	acceleration = (target_speed > speed) ? -get_linear_deceleration()
 					      : get_linear_acceleration();
+	if (jerk > 0.)
+		return _jerk_limited_time(fabsf(speed - target_speed),
+					  fabsf(acceleration), jerk);
 
 	return (speed - target_speed) / acceleration;
 }
@@ -110,30 +208,17 @@ uint32_t required_ticks_to_speed(float speed)
  */
 void target_straight(int32_t start, float distance, float speed)
 {
-	int32_t target_distance;
-
-	set_ideal_angular_speed(0.);
-
-	target_distance = start + (int32_t)(distance * MICROMETERS_PER_METER);
-	if (distance > 0) {
-		set_target_linear_speed(get_max_linear_speed());
-		while (get_encoder_average_micrometers() <
-		       target_distance - required_micrometers_to_speed(speed))
-			;
-	} else {
-		set_target_linear_speed(-get_max_linear_speed());
-		while (get_encoder_average_micrometers() >
-		       target_distance - required_micrometers_to_speed(speed))
-			;
-	}
-	set_target_linear_speed(speed);
-	if (speed == 0.) {
-		while (get_ideal_linear_speed() != speed)
-			;
-	} else {
-		while (get_encoder_average_micrometers() < target_distance)
-			;
-	}
+	struct motion_segment segment = {0};
+
+	segment.type = MOTION_STRAIGHT;
+	segment.control = MOTION_KEEP_CONTROL;
+	segment.anchored = true;
+	segment.start = start;
+	segment.distance = distance;
+	segment.end_speed = speed;
+	if (!push_motion(&segment))
+		return;
+	wait_motion_idle();
 }
 
 /**
@@ -148,83 +233,41 @@ void target_straight(int32_t start, float distance, float speed)
 static void target_straight_diagonal(int32_t start, float distance,
 				     float control_distance, float speed)
 {
-	int32_t target_distance, target_control_distance;
-
-	set_ideal_angular_speed(0.);
-	target_distance = start + (int32_t)(distance * MICROMETERS_PER_METER);
-	target_control_distance =
-	    start + (int32_t)(control_distance * MICROMETERS_PER_METER);
-	diagonal_sensors_control(true);
-	set_target_linear_speed(get_max_linear_speed());
-	while (get_encoder_average_micrometers() <
-	       target_distance - required_micrometers_to_speed(speed)) {
-		if (get_encoder_average_micrometers() > target_control_distance)
-			diagonal_sensors_control(false);
-	};
-	set_target_linear_speed(speed);
-	while (get_encoder_average_micrometers() < target_distance) {
-		if (get_encoder_average_micrometers() > target_control_distance)
-			diagonal_sensors_control(false);
-	};
-}
-
-/**
- * @brief Wait until the robot is perpendicular with respect to the front wall.
- *
- * @param[in] error Allowed error, in meters.
- */
-static void wait_front_perpendicular(float error)
-{
-	int i;
-	float average = 0.;
-
-	while (true) {
-		for (i = 0; i < 20; i++) {
-			average += get_front_sensors_error();
-			sleep_ticks(2);
-		}
-		average /= 20;
-		if (average < error)
-			break;
-	}
+	struct motion_segment segment = {0};
+
+	segment.type = MOTION_DIAGONAL;
+	segment.control = MOTION_KEEP_CONTROL;
+	segment.anchored = true;
+	segment.start = start;
+	segment.distance = distance;
+	segment.control_distance = control_distance;
+	segment.end_speed = speed;
+	if (!push_motion(&segment))
+		return;
+	wait_motion_idle();
 }
 
 /**
  * @brief Keep a specified distance from the front wall.
  *
+ * Distance and angle to the front wall are servoed at the same time, at the
+ * control rate, until both errors converge.
+ *
  * @param[in] distance Distance to keep from the front wall, in meters.
  */
 void keep_front_wall_distance(float distance)
 {
-	int i;
-	float diff;
-	float front_wall_distance;
+	struct motion_segment segment = {0};
 
 	if (!front_wall_detection())
 		return;
 
-	set_max_force(get_max_force() / 2.);
-
-	while (true) {
-		front_sensors_control(true);
-		side_sensors_close_control(false);
-		side_sensors_far_control(false);
-
-		wait_front_perpendicular(KEEP_FRONT_DISTANCE_TOLERANCE);
-
-		front_wall_distance = 0.;
-		for (i = 0; i < 20; i++) {
-			front_wall_distance += get_front_wall_distance();
-			sleep_ticks(2);
-		}
-		front_wall_distance /= 20;
-		diff = front_wall_distance - distance;
-		if (fabsf(diff) < KEEP_FRONT_DISTANCE_TOLERANCE)
-			break;
-		target_straight(get_encoder_average_micrometers(), diff, 0.);
-	}
-
-	set_max_force(get_max_force() * 2.);
+	segment.type = MOTION_FRONT_ALIGN;
+	segment.control = MOTION_FRONT_CONTROL;
+	segment.distance = distance;
+	if (!push_motion(&segment))
+		return;
+	wait_motion_idle();
 
 	disable_walls_control();
 	reset_control_all();
@@ -318,6 +361,141 @@ void turn_to_start_position(float force)
 	drive_break();
 }
 
+/**
+ * @brief Move to the middle of the estimated cell, along the heading.
+ *
+ * The side walls control keeps the mouse centered while moving. Any error in
+ * the estimated cell is a whole number of cells along the heading, so the
+ * mouse stops in the middle of a cell anyway.
+ */
+static void _move_to_cell_middle(void)
+{
+	uint8_t cell;
+	struct pose pose = get_pose();
+	struct pose middle;
+
+	if (!find_pose_cell(&pose, &cell))
+		return;
+	make_cell_pose(&middle, cell, find_pose_direction(&pose),
+		       CELL_DIMENSION / 2.);
+	side_sensors_close_control(true);
+	target_straight(get_encoder_average_micrometers(),
+			(middle.x - pose.x) * cos(middle.theta) +
+			    (middle.y - pose.y) * sin(middle.theta),
+			0.);
+}
+
+/**
+ * @brief Find the cell the mouse is in after a collision.
+ *
+ * The mouse must be stopped in the middle of a cell, so that the walls read
+ * are reliable. The pose estimation cell is checked first, and then its
+ * neighbors along the heading, as collisions usually happen right when
+ * entering or leaving a cell. A visited cell is only accepted if the walls
+ * read match its known walls. Unvisited neighbors are skipped, and the pose
+ * estimation cell is only accepted unvisited if no neighbor matches.
+ *
+ * The search position is restored if the mouse cannot be located.
+ *
+ * @param[out] cell Cell the mouse is in.
+ * @param[out] direction Direction the mouse is facing.
+ *
+ * @return Whether the mouse could be located.
+ */
+static bool _locate_after_collision(uint8_t *cell,
+				    enum compass_direction *direction)
+{
+	int i;
+	bool unvisited = false;
+	uint8_t estimated = 0;
+	uint8_t position = search_position();
+	enum compass_direction heading = search_direction();
+	struct pose pose = get_pose();
+	struct pose candidate;
+	struct walls_around walls = read_walls();
+	struct walls_around known;
+	const float shifts[] = {0., -CELL_DIMENSION, CELL_DIMENSION};
+
+	*direction = find_pose_direction(&pose);
+	make_cell_pose(&candidate, 0, *direction, 0.);
+	for (i = 0; i < 3; i++) {
+		candidate.x = pose.x + shifts[i] * cos(candidate.theta);
+		candidate.y = pose.y + shifts[i] * sin(candidate.theta);
+		if (!find_pose_cell(&candidate, cell))
+			continue;
+		set_search_position(*cell, *direction);
+		if (!current_cell_is_visited()) {
+			if (i == 0) {
+				unvisited = true;
+				estimated = *cell;
+			}
+			continue;
+		}
+		known = current_walls_around();
+		if (known.left == walls.left && known.front == walls.front &&
+		    known.right == walls.right)
+			return true;
+	}
+	if (unvisited) {
+		*cell = estimated;
+		set_search_position(*cell, *direction);
+		return true;
+	}
+	set_search_position(position, heading);
+	return false;
+}
+
+/**
+ * @brief Recover from a collision, stopping in the middle of a cell.
+ *
+ * The mouse backs off from the obstacle and re-aligns with the front wall, if
+ * any, or with the side walls while moving to the middle of the estimated
+ * cell. Walls are then read to locate the mouse. The search position, the
+ * pose estimation and the cell start are then reset, so search movements can
+ * be resumed from there.
+ *
+ * If the mouse could not be located, the collision detected signal is set
+ * again, so the failure is not lost to the callers checking it.
+ *
+ * @return Whether the mouse recovered and could be located.
+ */
+bool recover_from_collision(void)
+{
+	uint8_t cell;
+	enum compass_direction direction;
+	bool located = false;
+
+	reset_motion();
+	enable_motor_control();
+	set_max_force(get_max_force() / 4.);
+
+	target_straight(get_encoder_average_micrometers(), -COLLISION_BACK_OFF,
+			0.);
+	if (!collision_detected()) {
+		if (front_wall_detection())
+			keep_front_wall_distance(CELL_DIMENSION / 2.);
+		else
+			_move_to_cell_middle();
+	}
+	if (!collision_detected())
+		located = _locate_after_collision(&cell, &direction);
+
+	set_max_force(get_max_force() * 4.);
+	disable_walls_control();
+	reset_control_errors();
+
+	if (!located || collision_detected()) {
+		set_collision_detected();
+		return false;
+	}
+	set_pose_in_cell(cell, direction, CELL_DIMENSION / 2.);
+	reset_path_translator(&search_translator, PATH_SEARCH);
+	current_cell_start_micrometers =
+	    get_encoder_average_micrometers() -
+	    CELL_DIMENSION / 2. * MICROMETERS_PER_METER;
+	return true;
+}
+
 /**
  * @brief Move front into the next cell.
  */
@@ -374,6 +552,7 @@ void move_side(enum movement turn, float force)
 			get_move_turn_linear_speed(turn, force));
 	disable_walls_control();
 	speed_turn(turn, force);
+	_learn_turn_exit(turn);
 	front_sensors_control(true);
 	side_sensors_close_control(true);
 	side_sensors_far_control(true);
@@ -385,13 +564,76 @@ void move_side(enum movement turn, float force)
 /**
  * @brief Move back into the previous cell.
  *
+ * The whole manoeuvre is queued at once, so the mouse brakes into the middle
+ * of the cell, turns in place and accelerates out without waiting in between.
+ * The front wall, if any, corrects the braking point on the fly.
+ *
  * @param[in] force Maximum force to apply on the tires.
  */
 void move_back(float force)
 {
-	stop_middle();
-	turn_back(force);
-	move_front();
+	float distance;
+	uint8_t control;
+	struct motion_segment segment = {0};
+
+	segment.type = MOTION_STRAIGHT;
+	segment.control = MOTION_FRONT_CONTROL | MOTION_SIDE_CLOSE_CONTROL;
+	segment.anchored = true;
+	segment.start = current_cell_start_micrometers;
+	segment.distance = CELL_DIMENSION / 2.;
+	segment.front_wall_distance = CELL_DIMENSION / 2.;
+	if (!push_motion(&segment))
+		return;
+
+	segment.type = MOTION_INPLACE_TURN;
+	segment.control = 0;
+	segment.anchored = false;
+	segment.distance = ((int)(rand() % 2) * 2 - 1) * PI;
+	segment.front_wall_distance = 0.;
+	segment.force = force;
+	if (!push_motion(&segment))
+		return;
+
+	distance = CELL_DIMENSION / 2. - SHIFT_AFTER_180_DEG_TURN;
+	control = MOTION_FRONT_CONTROL | MOTION_SIDE_CLOSE_CONTROL;
+	if (!push_motion_straight(distance, get_max_linear_speed(), control))
+		return;
+	wait_motion_idle();
+	_entered_next_cell();
+}
+
+/**
+ * @brief Move according to a raw search step.
+ *
+ * Search steps go through the same path translation as speed runs, with the
+ * search language, and the translated movements are executed as soon as the
+ * translator emits them.
+ *
+ * @param[in] raw Raw step (`F`, `L` or `R`).
+ * @param[in] force Maximum force to apply on the tires.
+ */
+static void move_raw_step(char raw, float force)
+{
+	int i;
+	int count;
+	enum movement emitted[PATH_LOOKAHEAD];
+
+	count = translate_raw_step(&search_translator, raw, emitted);
+	for (i = 0; i < count; i++) {
+		switch (emitted[i]) {
+		case MOVE_FRONT:
+			move_front();
+			break;
+		case MOVE_LEFT:
+		case MOVE_RIGHT:
+			move_side(emitted[i], force);
+			break;
+		default:
+			LOG_ERROR("Unable to process search movement [%d]!",
+				  emitted[i]);
+			break;
+		}
+	}
 }
 
 /**
@@ -403,11 +645,11 @@ void move_back(float force)
 void move(enum step_direction direction, float force)
 {
 	if (direction == LEFT)
-		move_side(MOVE_LEFT, force);
+		move_raw_step('L', force);
 	else if (direction == RIGHT)
-		move_side(MOVE_RIGHT, force);
+		move_raw_step('R', force);
 	else if (direction == FRONT)
-		move_front();
+		move_raw_step('F', force);
 	else if (direction == BACK)
 		move_back(force);
 	else
@@ -422,91 +664,45 @@ void move(enum step_direction direction, float force)
  */
 void inplace_turn(float radians, float force)
 {
-	int turn_sign;
-	int32_t start;
-	int32_t current;
-	float time;
-	float angular_velocity;
-	float max_angular_velocity;
-	float factor;
-	float arc;
-	float transition;
-	float duration;
-	float transition_angle;
-
-	turn_sign = sign(radians);
-	radians = fabsf(radians);
-	angular_acceleration =
-	    force * MOUSE_WHEELS_SEPARATION / MOUSE_MOMENT_OF_INERTIA;
-	max_angular_velocity = sqrt(radians / 2 * angular_acceleration);
-	if (max_angular_velocity > MOUSE_MAX_ANGULAR_VELOCITY)
-		max_angular_velocity = MOUSE_MAX_ANGULAR_VELOCITY;
-
-	duration = max_angular_velocity / angular_acceleration * PI;
-	transition_angle = duration * max_angular_velocity / PI;
-	arc = (radians - 2 * transition_angle) / max_angular_velocity;
-	transition = duration / 2;
-	max_angular_velocity = turn_sign * max_angular_velocity;
-
-	set_target_linear_speed(get_ideal_linear_speed());
-	disable_walls_control();
-	start = get_clock_ticks();
-	while (true) {
-		current = get_clock_ticks();
-		time = (float)(current - start) / SYSTICK_FREQUENCY_HZ;
-		if (time >= 2 * transition + arc)
-			break;
-		angular_velocity = max_angular_velocity;
-		if (time < transition) {
-			factor = time / transition;
-			angular_velocity *= sin(factor * PI / 2);
-		} else if (time >= transition + arc) {
-			factor = (time - arc) / transition;
-			angular_velocity *= sin(factor * PI / 2);
-		}
-		set_ideal_angular_speed(angular_velocity);
-	}
-	set_ideal_angular_speed(0);
+	struct motion_segment segment = {0};
+
+	segment.type = MOTION_INPLACE_TURN;
+	segment.control = MOTION_KEEP_CONTROL;
+	segment.distance = radians;
+	segment.force = force;
+	if (!push_motion(&segment))
+		return;
+	wait_motion_idle();
 }
 
 /**
- * @brief Execute a movement sequence.
+ * @brief Execute a smooth path.
  *
- * The sequence is a raw/sharp path, which will be smoothed before execution.
+ * The speed of every turn is planned over the whole path before starting, so
+ * that it is always reachable from the previous movements and it allows
+ * braking for the following ones.
  *
- * @param[in] sequence Sequence of raw movements to execute.
+ * @param[in] path Smooth path segments to execute.
  * @param[in] force Maximum force to apply on the tires.
- * @param[in] language Language to use for the raw-to-smooth path translation.
  */
-void execute_movement_sequence(char *sequence, float force,
-			       enum path_language language)
+void execute_movement_path(struct path_segment *path, float force)
 {
-	int i = 0;
-	int many = 0;
-	char movement;
+	enum movement movement;
 	float distance = 0;
-	enum movement smooth_path[MAX_SMOOTH_PATH_LEN];
+	float *speed = planned_speeds;
 
-	make_smooth_path(sequence, smooth_path, language);
+	plan_path_speeds(path, force, planned_speeds);
 	while (true) {
-		movement = smooth_path[i++];
+		movement = path->movement;
 		switch (movement) {
 		case MOVE_START:
 			distance = -MOUSE_START_SHIFT;
 			break;
 		case MOVE_FRONT:
+			distance += path->count * CELL_DIMENSION;
+			break;
 		case MOVE_DIAGONAL:
-			many = 0;
-			while (true) {
-				many += 1;
-				if (smooth_path[i] != movement)
-					break;
-				i++;
-			}
-			if (movement == MOVE_FRONT)
-				distance += many * CELL_DIMENSION;
-			else
-				distance += many * CELL_DIAGONAL;
+			distance += path->count * CELL_DIAGONAL;
 			break;
 		case MOVE_LEFT:
 		case MOVE_RIGHT:
@@ -514,6 +710,10 @@ void execute_movement_sequence(char *sequence, float force,
 		case MOVE_RIGHT_90:
 		case MOVE_LEFT_180:
 		case MOVE_RIGHT_180:
+		case MOVE_LEFT_90_LONG:
+		case MOVE_RIGHT_90_LONG:
+		case MOVE_LEFT_180_LONG:
+		case MOVE_RIGHT_180_LONG:
 		case MOVE_LEFT_TO_45:
 		case MOVE_RIGHT_TO_45:
 		case MOVE_LEFT_TO_135:
@@ -521,10 +721,11 @@ void execute_movement_sequence(char *sequence, float force,
 			distance += get_move_turn_before(movement);
 			side_sensors_close_control(true);
 			side_sensors_far_control(false);
-			parametric_move_front(
-			    distance,
-			    get_move_turn_linear_speed(movement, force));
-			speed_turn(movement, force);
+			parametric_move_front(distance, *speed);
+			if (!push_motion_turn(movement, *speed))
+				return;
+			wait_motion_idle();
+			_learn_turn_exit(movement);
 			distance = get_move_turn_after(movement);
 			break;
 		case MOVE_LEFT_FROM_45:
@@ -536,10 +737,13 @@ void execute_movement_sequence(char *sequence, float force,
 			distance += get_move_turn_before(movement);
 			side_sensors_close_control(false);
 			side_sensors_far_control(false);
-			parametric_move_diagonal(
-			    distance, (distance - CELL_DIAGONAL * 2),
-			    get_move_turn_linear_speed(movement, force));
-			speed_turn(movement, force);
+			parametric_move_diagonal(distance,
+						 (distance - CELL_DIAGONAL * 2),
+						 *speed);
+			if (!push_motion_turn(movement, *speed))
+				return;
+			wait_motion_idle();
+			_learn_turn_exit(movement);
 			distance = get_move_turn_after(movement);
 			break;
 		case MOVE_STOP:
@@ -560,5 +764,25 @@ void execute_movement_sequence(char *sequence, float force,
 			LOG_ERROR("Collision detected!");
 			return;
 		}
+		path++;
+		speed++;
 	}
 }
+
+/**
+ * @brief Execute a movement sequence.
+ *
+ * The sequence is a raw/sharp path, which will be smoothed before execution.
+ *
+ * @param[in] sequence Sequence of raw movements to execute.
+ * @param[in] force Maximum force to apply on the tires.
+ * @param[in] language Language to use for the raw-to-smooth path translation.
+ */
+void execute_movement_sequence(char *sequence, float force,
+			       enum path_language language)
+{
+	struct path_segment path[MAX_SMOOTH_PATH_LEN];
+
+	make_smooth_segments(sequence, path, language);
+	execute_movement_path(path, force);
+}
@@ -7,6 +7,7 @@
 #include "mmlib/control.h"
 #include "mmlib/hmi.h"
 #include "mmlib/logging.h"
+#include "mmlib/motion.h"
 #include "mmlib/path.h"
 #include "mmlib/search.h"
 #include "mmlib/speed.h"
@@ -26,6 +27,7 @@ void stop_head_front_wall(void);
 void stop_middle(void);
 void turn_back(float force);
 void turn_to_start_position(float force);
+bool recover_from_collision(void);
 void move_front(void);
 void parametric_move_front(float distance, float end_linear_speed);
 void parametric_move_diagonal(float distance, float control_distance,
@@ -34,6 +36,7 @@ void move_side(enum movement turn, float force);
 void move_back(float force);
 void move(enum step_direction direction, float force);
 void inplace_turn(float radians, float force);
+void execute_movement_path(struct path_segment *path, float force);
 void execute_movement_sequence(char *sequence, float force,
 			       enum path_language language);
 
@@ -14,6 +14,9 @@ struct translation {
 // clang-format off
 /**
  * @brief This dictionary defines different ways to translate to a smooth path.
+ *
+ * The last raw character of a translation is not consumed, as it is also the
+ * first one of the next translation, unless the translation has only one.
  */
 static struct translation *dictionary[LANGUAGES_COUNT][PATH_STATES_COUNT] = {
     [PATH_SAFE] = {
@@ -45,34 +48,362 @@ static struct translation *dictionary[LANGUAGES_COUNT][PATH_STATES_COUNT] = {
 	    {"", MOVE_NONE},
 	},
     },
+    [PATH_AGGRESSIVE] = {
+	[ORTHOGONAL] = (struct translation[]){
+	    {"LFLF", MOVE_LEFT_180_LONG}, {"RFRF", MOVE_RIGHT_180_LONG},
+	    {"LF", MOVE_LEFT_90_LONG},    {"RF", MOVE_RIGHT_90_LONG},
+	    {"LR", MOVE_LEFT_TO_45},      {"RL", MOVE_RIGHT_TO_45},
+	    {"LLF", MOVE_LEFT_180},       {"RRF", MOVE_RIGHT_180},
+	    {"LLR", MOVE_LEFT_TO_135},    {"RRL", MOVE_RIGHT_TO_135},
+	    {"", MOVE_NONE},
+	},
+	[DIAGONAL] = (struct translation[]){
+	    {"LR", MOVE_DIAGONAL},       {"RL", MOVE_DIAGONAL},
+	    {"LF", MOVE_LEFT_FROM_45},   {"RF", MOVE_RIGHT_FROM_45},
+	    {"LLR", MOVE_LEFT_DIAGONAL}, {"RRL", MOVE_RIGHT_DIAGONAL},
+	    {"LLF", MOVE_LEFT_FROM_135}, {"RRF", MOVE_RIGHT_FROM_135},
+	    {"", MOVE_NONE},
+	},
+    },
+    [PATH_SEARCH] = {
+	[ORTHOGONAL] = (struct translation[]){
+	    {"L", MOVE_LEFT}, {"R", MOVE_RIGHT},
+	    {"", MOVE_NONE},
+	},
+	[DIAGONAL] = (struct translation[]){
+	    {"L", MOVE_LEFT}, {"R", MOVE_RIGHT},
+	    {"", MOVE_NONE},
+	},
+    },
 };
 // clang-format on
 
+/* Raw characters the translation automaton reacts to, end of path last */
+#define AUTOMATON_INPUTS 6
+#define MAX_AUTOMATON_STATES 16
+
+static const char automaton_inputs[AUTOMATON_INPUTS] = {'B', 'S', 'F',
+							'L', 'R', '\0'};
+
 /**
- * @brief Translate the source path to a smooth path.
+ * Translation automaton state, as found while building the automaton.
  *
- * @param[in] source Raw path to translate from.
- * @param[in] path_language Language to use for the translation.
- * @param[in] path_state The current path state.
+ * - Path state.
+ * - Raw characters read but not translated yet (null-terminated).
+ */
+struct automaton_state {
+	enum path_state path_state;
+	char pending[PATH_LOOKAHEAD + 1];
+};
+
+/**
+ * Translation automaton transition.
  *
- * @return The translated next movement.
+ * - Next automaton state.
+ * - Number of movements emitted.
+ * - Movements emitted.
  */
-static struct translation translate(char *source, enum path_language language,
-				    enum path_state state)
+struct transition {
+	uint8_t next;
+	uint8_t count;
+	uint8_t emitted[PATH_LOOKAHEAD];
+};
+
+static struct transition automaton[LANGUAGES_COUNT][MAX_AUTOMATON_STATES]
+				  [AUTOMATON_INPUTS];
+static bool automaton_built[LANGUAGES_COUNT];
+static bool automaton_overflow[LANGUAGES_COUNT];
+
+/**
+ * @brief Find the dictionary translation for the pending raw characters.
+ *
+ * Translations are checked in dictionary order. The first one that agrees
+ * with the pending characters decides: it is the match if the pending
+ * characters cover it, otherwise more characters are required to decide.
+ *
+ * @param[in] pending Pending raw characters (null-terminated).
+ * @param[in] language Language to use for the translation.
+ * @param[in] state The current path state.
+ * @param[in] final Whether the raw path ends after the pending characters.
+ * @param[out] wait Whether more raw characters are required to decide.
+ *
+ * @return The matching translation or `NULL` if there is none.
+ */
+static struct translation *find_translation(char *pending,
+					    enum path_language language,
+					    enum path_state state, bool final,
+					    bool *wait)
 {
 	int length;
+	int available;
 	struct translation *candidate;
 
+	*wait = false;
+	available = strlen(pending);
 	candidate = dictionary[language][state];
-	while (true) {
+	for (; candidate->to != MOVE_NONE; candidate++) {
 		length = strlen(candidate->from);
-		if (!length)
+		if (strncmp(pending, candidate->from,
+			    length < available ? length : available))
+			continue;
+		if (length <= available)
+			return candidate;
+		if (final)
+			continue;
+		*wait = true;
+		break;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Emit a movement in an automaton transition.
+ *
+ * @param[in,out] transition Transition to add the movement to.
+ * @param[in] movement Movement to emit.
+ */
+static void emit_movement(struct transition *transition,
+			  enum movement movement)
+{
+	if (transition->count < PATH_LOOKAHEAD)
+		transition->emitted[transition->count++] = movement;
+}
+
+/**
+ * @brief Translate as many pending raw characters as possible.
+ *
+ * Raw characters that cannot be translated at all are dropped.
+ *
+ * @param[in,out] state Automaton state, with the pending raw characters.
+ * @param[in] language Language to use for the translation.
+ * @param[in] final Whether the raw path ends after the pending characters.
+ * @param[out] transition Transition to emit the translated movements to.
+ */
+static void resolve_pending(struct automaton_state *state,
+			    enum path_language language, bool final,
+			    struct transition *transition)
+{
+	bool wait;
+	int length;
+	char *pending = state->pending;
+	struct translation *translated;
+
+	while (*pending != '\0') {
+		switch (*pending) {
+		case 'B':
+			emit_movement(transition, MOVE_START);
+			pending++;
+			continue;
+		case 'S':
+			emit_movement(transition, MOVE_STOP);
+			pending++;
+			continue;
+		case 'F':
+			state->path_state = ORTHOGONAL;
+			emit_movement(transition, MOVE_FRONT);
+			pending++;
+			continue;
+		default:
 			break;
-		if (!strncmp(source, candidate->from, length))
-			return *candidate;
-		candidate++;
+		}
+		translated = find_translation(pending, language,
+					      state->path_state, final, &wait);
+		if (wait)
+			break;
+		if (translated) {
+			emit_movement(transition, translated->to);
+			length = strlen(translated->from);
+			pending += length > 1 ? length - 1 : 1;
+		} else if (state->path_state == DIAGONAL) {
+			pending++;
+		}
+		state->path_state = DIAGONAL;
 	}
-	return *candidate;
+	memmove(state->pending, pending, strlen(pending) + 1);
+}
+
+/**
+ * @brief Find an automaton state, adding it if it was not found before.
+ *
+ * @param[in,out] states Automaton states found so far.
+ * @param[in,out] count Number of automaton states found so far.
+ * @param[in] state Automaton state to find.
+ * @param[out] index The automaton state index.
+ *
+ * @return Whether the state was found or added, false if there is no room.
+ */
+static bool find_automaton_state(struct automaton_state *states, int *count,
+				 struct automaton_state state, uint8_t *index)
+{
+	int i;
+
+	for (i = 0; i < *count; i++) {
+		if (states[i].path_state == state.path_state &&
+		    !strcmp(states[i].pending, state.pending)) {
+			*index = i;
+			return true;
+		}
+	}
+	if (*count == MAX_AUTOMATON_STATES)
+		return false;
+	states[(*count)++] = state;
+	*index = i;
+	return true;
+}
+
+/**
+ * @brief Build the translation automaton of a language.
+ *
+ * The automaton is derived from the dictionary, exploring every state that
+ * can be reached from the initial one. Each state is defined by the path
+ * state and the raw characters that are still pending to be translated.
+ *
+ * If the states do not fit in `MAX_AUTOMATON_STATES`, transitions to the
+ * missing states fall back to the initial state and the automaton is marked
+ * as overflowed, as it would mistranslate some paths.
+ *
+ * @param[in] language Language to build the automaton for.
+ */
+static void build_automaton(enum path_language language)
+{
+	int i;
+	int j;
+	int length;
+	int count = 1;
+	struct automaton_state states[MAX_AUTOMATON_STATES];
+	struct automaton_state state;
+	struct transition *transition;
+
+	automaton_overflow[language] = false;
+	states[0].path_state = DIAGONAL;
+	states[0].pending[0] = '\0';
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < AUTOMATON_INPUTS; j++) {
+			transition = &automaton[language][i][j];
+			transition->count = 0;
+			transition->next = 0;
+			state = states[i];
+			length = strlen(state.pending);
+			state.pending[length] = automaton_inputs[j];
+			state.pending[length + 1] = '\0';
+			resolve_pending(&state, language,
+					automaton_inputs[j] == '\0',
+					transition);
+			if (automaton_inputs[j] == '\0')
+				continue;
+			if (!find_automaton_state(states, &count, state,
+						  &transition->next))
+				automaton_overflow[language] = true;
+		}
+	}
+	automaton_built[language] = true;
+}
+
+/**
+ * @brief Build the translation automata of all languages.
+ *
+ * Automata are built only once, so this function should be called at
+ * configuration time, before any path is translated. Otherwise they are
+ * built on the first translated raw character.
+ *
+ * @return Whether all the automata fit in `MAX_AUTOMATON_STATES`.
+ */
+bool build_path_automata(void)
+{
+	int language;
+	bool fit = true;
+
+	for (language = 0; language < LANGUAGES_COUNT; language++) {
+		if (!automaton_built[language])
+			build_automaton(language);
+		if (automaton_overflow[language])
+			fit = false;
+	}
+	return fit;
+}
+
+/**
+ * @brief Reset a path translator to translate a new raw path.
+ *
+ * @param[out] translator Translator to reset.
+ * @param[in] language Language to use for the translation.
+ */
+void reset_path_translator(struct path_translator *translator,
+			   enum path_language language)
+{
+	translator->language = language;
+	translator->state = 0;
+}
+
+/**
+ * @brief Feed the next raw path character to a path translator.
+ *
+ * Each character costs a single automaton transition, no matter how many
+ * translations the language defines. Movements are emitted as soon as the
+ * characters read so far resolve them.
+ *
+ * @param[in,out] translator Translator to feed the character to.
+ * @param[in] raw Raw path character, `'\0'` to flush at the end of the path.
+ * @param[out] emitted Array to write the emitted movements to, with room for
+ * at least `PATH_LOOKAHEAD` movements.
+ *
+ * @return The number of movements emitted.
+ */
+int translate_raw_step(struct path_translator *translator, char raw,
+		       enum movement *emitted)
+{
+	int i;
+	int input;
+	struct transition *transition;
+
+	if (!automaton_built[translator->language])
+		build_automaton(translator->language);
+	for (input = 0; input < AUTOMATON_INPUTS - 1; input++)
+		if (automaton_inputs[input] == raw)
+			break;
+	transition = &automaton[translator->language][translator->state][input];
+	for (i = 0; i < transition->count; i++)
+		emitted[i] = transition->emitted[i];
+	translator->state = transition->next;
+	return transition->count;
+}
+
+/**
+ * @brief Check whether a movement merges into an existing path segment.
+ *
+ * Consecutive front or diagonal movements are merged into a single segment,
+ * as long as its count fits.
+ *
+ * @param[in] segment Last path segment.
+ * @param[in] movement Movement to append.
+ *
+ * @return Whether the movement merges into the segment.
+ */
+bool path_segment_merges(struct path_segment *segment, enum movement movement)
+{
+	return segment->movement == movement && segment->count < UINT8_MAX &&
+	       (movement == MOVE_FRONT || movement == MOVE_DIAGONAL);
+}
+
+/**
+ * @brief Append a movement to a path of segments.
+ *
+ * @param[in,out] path Path to append the movement to.
+ * @param[in] length Current path length, in segments.
+ * @param[in] movement Movement to append.
+ *
+ * @return The new path length.
+ */
+int append_path_segment(struct path_segment *path, int length,
+			enum movement movement)
+{
+	if (length && path_segment_merges(&path[length - 1], movement)) {
+		path[length - 1].count++;
+		return length;
+	}
+	path[length].movement = movement;
+	path[length].count = 1;
+	return length + 1;
 }
 
 /**
@@ -85,34 +416,38 @@ static struct translation translate(char *source, enum path_language language,
 void make_smooth_path(char *source, enum movement *destination,
 		      enum path_language language)
 {
-	enum path_state state = DIAGONAL;
-	struct translation translated;
+	struct path_translator translator;
 
-	while (true) {
-		if (*source == '\0')
-			break;
-		if (*source == 'B') {
-			*destination++ = MOVE_START;
-			source++;
-			continue;
-		}
-		if (*source == 'S') {
-			*destination++ = MOVE_STOP;
-			source++;
-			continue;
-		}
-		if (*source == 'F') {
-			state = ORTHOGONAL;
-			*destination++ = MOVE_FRONT;
-			source++;
-			continue;
-		}
-		translated = translate(source, language, state);
-		if (translated.to != MOVE_NONE) {
-			*destination++ = translated.to;
-			source += strlen(translated.from) - 1;
-		}
-		state = DIAGONAL;
-	}
+	reset_path_translator(&translator, language);
+	do {
+		destination +=
+		    translate_raw_step(&translator, *source, destination);
+	} while (*source++ != '\0');
 	*destination = MOVE_END;
 }
+
+/**
+ * @brief Make a smooth path of segments out of a raw, exploration path.
+ *
+ * @param[in] source Raw path to smooth.
+ * @param[out] destination Array to write the smooth path segments to.
+ * @param[in] path_language Language to use for the translation.
+ */
+void make_smooth_segments(char *source, struct path_segment *destination,
+			  enum path_language language)
+{
+	int i;
+	int count;
+	int length = 0;
+	struct path_translator translator;
+	enum movement emitted[PATH_LOOKAHEAD];
+
+	reset_path_translator(&translator, language);
+	do {
+		count = translate_raw_step(&translator, *source, emitted);
+		for (i = 0; i < count; i++)
+			length = append_path_segment(destination, length,
+						     emitted[i]);
+	} while (*source++ != '\0');
+	append_path_segment(destination, length, MOVE_END);
+}
@@ -2,11 +2,17 @@
 #define __PATH_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
+/* Maximum number of raw characters required to translate a movement */
+#define PATH_LOOKAHEAD 4
+
 enum path_language {
-	PATH_SAFE,      /**< Do not generate smooth diagonals */
-	PATH_DIAGONALS, /**< Generate smooth diagonals */
+	PATH_SAFE,       /**< Do not generate smooth diagonals */
+	PATH_DIAGONALS,  /**< Generate smooth diagonals */
+	PATH_AGGRESSIVE, /**< Generate diagonals and long-radius turns */
+	PATH_SEARCH,     /**< Translate search steps without lookahead */
 	LANGUAGES_COUNT,
 };
 
@@ -22,6 +28,10 @@ enum movement {
 	MOVE_RIGHT_90,
 	MOVE_LEFT_180,
 	MOVE_RIGHT_180,
+	MOVE_LEFT_90_LONG,
+	MOVE_RIGHT_90_LONG,
+	MOVE_LEFT_180_LONG,
+	MOVE_RIGHT_180_LONG,
 	MOVE_LEFT_TO_45,
 	MOVE_RIGHT_TO_45,
 	MOVE_LEFT_TO_135,
@@ -36,7 +46,42 @@ enum movement {
 	MOVE_NONE,
 };
 
+/**
+ * A smooth movement repeated a number of times.
+ *
+ * Packed in two bytes: the `enum movement` opcode and its repeat count. Only
+ * front and diagonal movements are merged, so any other movement always has a
+ * count of one.
+ */
+struct path_segment {
+	uint8_t movement;
+	uint8_t count;
+};
+
+/**
+ * Streaming raw path translation state.
+ *
+ * Raw characters are pushed one at a time and translated by an automaton built
+ * from the language dictionary. Smooth movements come out as soon as the raw
+ * characters pushed so far resolve them, which takes at most
+ * `PATH_LOOKAHEAD` characters.
+ */
+struct path_translator {
+	enum path_language language;
+	uint8_t state;
+};
+
+bool build_path_automata(void);
+void reset_path_translator(struct path_translator *translator,
+			   enum path_language language);
+int translate_raw_step(struct path_translator *translator, char raw,
+		       enum movement *emitted);
+bool path_segment_merges(struct path_segment *segment, enum movement movement);
+int append_path_segment(struct path_segment *path, int length,
+			enum movement movement);
 void make_smooth_path(char *raw_path, enum movement *smooth_path,
 		      enum path_language language);
+void make_smooth_segments(char *source, struct path_segment *destination,
+			  enum path_language language);
 
 #endif /* __PATH_H */
@@ -0,0 +1,296 @@
+#include "pose.h"
+
+/* Weight of the gyroscope, against the encoders, for the heading rate */
+#define POSE_GYRO_WEIGHT 0.9
+
+/**
+ * Pose estimation state.
+ *
+ * - Estimated pose.
+ * - Cosine and sine of the estimated orientation.
+ * - Average encoder reading at the last update, in micrometers.
+ */
+static volatile struct pose_estimation {
+	struct pose pose;
+	float cosine;
+	float sine;
+	int32_t micrometers;
+} estimation;
+
+/**
+ * @brief Get the orientation that corresponds to a compass direction.
+ *
+ * @param[in] direction Compass direction.
+ *
+ * @return The orientation, in radians, counter-clockwise from east.
+ */
+static float _compass_direction_angle(enum compass_direction direction)
+{
+	if (direction == EAST)
+		return 0.;
+	if (direction == NORTH)
+		return PI / 2;
+	if (direction == WEST)
+		return PI;
+	return -PI / 2;
+}
+
+/**
+ * @brief Wrap an angle to the [-PI, PI) range.
+ */
+static float _wrap_angle(float angle)
+{
+	while (angle >= PI)
+		angle -= 2 * PI;
+	while (angle < -PI)
+		angle += 2 * PI;
+	return angle;
+}
+
+/**
+ * @brief Get the corridor the mouse is running along.
+ *
+ * The estimated orientation is rounded to the closest orthogonal or diagonal
+ * direction, and the corridor centre lines follow that direction through the
+ * cell centres or through the cell edge midpoints, respectively.
+ *
+ * @param[out] angle Corridor direction, in radians.
+ * @param[out] spacing Distance between parallel corridor centre lines.
+ */
+static void _closest_corridor(float *angle, float *spacing)
+{
+	int octant;
+
+	octant = (int)floorf(estimation.pose.theta / (PI / 4) + 0.5);
+	*angle = octant * PI / 4;
+	*spacing = (octant % 2) ? CELL_DIAGONAL : CELL_DIMENSION;
+}
+
+/**
+ * @brief Make the pose of a mouse inside a cell.
+ *
+ * @param[out] pose Pose to write to.
+ * @param[in] cell Cell the mouse is in.
+ * @param[in] direction Direction the mouse is facing.
+ * @param[in] shift Distance from the cell entry edge, in meters.
+ */
+void make_cell_pose(struct pose *pose, uint8_t cell,
+		    enum compass_direction direction, float shift)
+{
+	pose->theta = _compass_direction_angle(direction);
+	pose->x = (cell % MAZE_SIZE + 0.5) * CELL_DIMENSION +
+		  cos(pose->theta) * (shift - CELL_DIMENSION / 2);
+	pose->y = (cell / MAZE_SIZE + 0.5) * CELL_DIMENSION +
+		  sin(pose->theta) * (shift - CELL_DIMENSION / 2);
+}
+
+/**
+ * @brief Find the cell a pose is in.
+ *
+ * @param[in] pose Pose to locate.
+ * @param[out] cell Cell the pose is in.
+ *
+ * @return Whether the pose is inside the maze.
+ */
+bool find_pose_cell(struct pose *pose, uint8_t *cell)
+{
+	int column;
+	int row;
+
+	if (pose->x < 0. || pose->y < 0.)
+		return false;
+	column = (int)(pose->x / CELL_DIMENSION);
+	row = (int)(pose->y / CELL_DIMENSION);
+	if (column >= MAZE_SIZE || row >= MAZE_SIZE)
+		return false;
+	*cell = row * MAZE_SIZE + column;
+	return true;
+}
+
+/**
+ * @brief Find the compass direction closest to the orientation of a pose.
+ *
+ * @param[in] pose Pose to round.
+ *
+ * @return The closest compass direction.
+ */
+enum compass_direction find_pose_direction(struct pose *pose)
+{
+	int quadrant;
+
+	quadrant = (int)floorf(_wrap_angle(pose->theta) / (PI / 2) + 0.5);
+	if (quadrant == 0)
+		return EAST;
+	if (quadrant == 1)
+		return NORTH;
+	if (quadrant == -1)
+		return SOUTH;
+	return WEST;
+}
+
+/**
+ * @brief Set the estimated pose.
+ *
+ * @param[in] pose Pose to set.
+ */
+void set_pose(struct pose *pose)
+{
+	estimation.pose.x = pose->x;
+	estimation.pose.y = pose->y;
+	estimation.pose.theta = _wrap_angle(pose->theta);
+	estimation.cosine = cos(estimation.pose.theta);
+	estimation.sine = sin(estimation.pose.theta);
+	estimation.micrometers = get_encoder_average_micrometers();
+}
+
+/**
+ * @brief Set the estimated pose inside a cell.
+ *
+ * @param[in] cell Cell the mouse is in.
+ * @param[in] direction Direction the mouse is facing.
+ * @param[in] shift Distance from the cell entry edge, in meters.
+ */
+void set_pose_in_cell(uint8_t cell, enum compass_direction direction,
+		      float shift)
+{
+	struct pose pose;
+
+	make_cell_pose(&pose, cell, direction, shift);
+	set_pose(&pose);
+}
+
+/**
+ * @brief Get the estimated pose.
+ */
+struct pose get_pose(void)
+{
+	return estimation.pose;
+}
+
+float get_pose_x(void)
+{
+	return estimation.pose.x;
+}
+
+float get_pose_y(void)
+{
+	return estimation.pose.y;
+}
+
+float get_pose_theta(void)
+{
+	return estimation.pose.theta;
+}
+
+/**
+ * @brief Get the lateral offset from the centre line of the corridor.
+ *
+ * @return The offset, in meters, positive to the left of the corridor
+ * direction.
+ */
+float get_pose_lateral_offset(void)
+{
+	float angle;
+	float spacing;
+	float lateral;
+
+	_closest_corridor(&angle, &spacing);
+	lateral = estimation.pose.y * cos(angle) -
+		  estimation.pose.x * sin(angle) - spacing / 2;
+	return lateral - spacing * floorf(lateral / spacing + 0.5);
+}
+
+/**
+ * @brief Correct the estimated pose with a lateral offset measurement.
+ *
+ * Useful when side walls are available.
+ *
+ * @param[in] offset Measured lateral offset from the corridor centre line, in
+ * meters, positive to the left.
+ * @param[in] weight Weight of the measurement, from 0 to 1.
+ */
+void correct_pose_lateral(float offset, float weight)
+{
+	float angle;
+	float spacing;
+	float error;
+
+	_closest_corridor(&angle, &spacing);
+	error = weight * (offset - get_pose_lateral_offset());
+	estimation.pose.x -= error * sin(angle);
+	estimation.pose.y += error * cos(angle);
+}
+
+/**
+ * @brief Correct the estimated pose with a longitudinal measurement.
+ *
+ * Useful when a front wall or a wall-to-post transition is detected.
+ *
+ * @param[in] error Distance the mouse is ahead of the estimated position, in
+ * meters, along the corridor direction.
+ * @param[in] weight Weight of the measurement, from 0 to 1.
+ */
+void correct_pose_forward(float error, float weight)
+{
+	float angle;
+	float spacing;
+
+	_closest_corridor(&angle, &spacing);
+	estimation.pose.x += weight * error * cos(angle);
+	estimation.pose.y += weight * error * sin(angle);
+}
+
+/**
+ * @brief Correct the estimated pose with an orientation measurement.
+ *
+ * @param[in] theta Measured orientation, in radians.
+ * @param[in] weight Weight of the measurement, from 0 to 1.
+ */
+void correct_pose_heading(float theta, float weight)
+{
+	estimation.pose.theta = _wrap_angle(
+	    estimation.pose.theta +
+	    weight * _wrap_angle(theta - estimation.pose.theta));
+	estimation.cosine = cos(estimation.pose.theta);
+	estimation.sine = sin(estimation.pose.theta);
+}
+
+/**
+ * @brief Update the estimated pose with the latest sensor readings.
+ *
+ * To be called on every control tick. The travelled distance comes from the
+ * encoders, while the heading rate blends the gyroscope and the encoders
+ * difference. The orientation cosine and sine are rotated incrementally to
+ * avoid trigonometric functions.
+ */
+void update_pose(void)
+{
+	int32_t micrometers = get_encoder_average_micrometers();
+	float distance;
+	float rate;
+	float delta;
+	float cosine;
+	float sine;
+	float norm;
+
+	distance = (float)(micrometers - estimation.micrometers) /
+		   MICROMETERS_PER_METER;
+	estimation.micrometers = micrometers;
+	rate = POSE_GYRO_WEIGHT * get_gyro_z_radps() +
+	       (1 - POSE_GYRO_WEIGHT) *
+		   (get_encoder_right_speed() - get_encoder_left_speed()) /
+		   MOUSE_WHEELS_SEPARATION;
+	delta = rate / SYSTICK_FREQUENCY_HZ;
+
+	cosine = estimation.cosine;
+	sine = estimation.sine;
+	estimation.pose.x += distance * (cosine - sine * delta / 2);
+	estimation.pose.y += distance * (sine + cosine * delta / 2);
+	estimation.pose.theta = _wrap_angle(estimation.pose.theta + delta);
+
+	cosine -= estimation.sine * delta;
+	sine += estimation.cosine * delta;
+	norm = 1.5 - (cosine * cosine + sine * sine) / 2;
+	estimation.cosine = cosine * norm;
+	estimation.sine = sine * norm;
+}
@@ -0,0 +1,42 @@
+#ifndef __POSE_H
+#define __POSE_H
+
+#include <math.h>
+
+#include "mmlib/encoder.h"
+#include "mmlib/mpu.h"
+#include "mmlib/search.h"
+
+#include "config.h"
+#include "setup.h"
+
+/**
+ * Mouse pose.
+ *
+ * - Position, in meters, from the south-west corner of the maze.
+ * - Orientation, in radians, counter-clockwise from east.
+ */
+struct pose {
+	float x;
+	float y;
+	float theta;
+};
+
+void make_cell_pose(struct pose *pose, uint8_t cell,
+		    enum compass_direction direction, float shift);
+bool find_pose_cell(struct pose *pose, uint8_t *cell);
+enum compass_direction find_pose_direction(struct pose *pose);
+void set_pose(struct pose *pose);
+void set_pose_in_cell(uint8_t cell, enum compass_direction direction,
+		      float shift);
+struct pose get_pose(void);
+float get_pose_x(void);
+float get_pose_y(void);
+float get_pose_theta(void);
+float get_pose_lateral_offset(void);
+void correct_pose_lateral(float offset, float weight);
+void correct_pose_forward(float error, float weight);
+void correct_pose_heading(float theta, float weight);
+void update_pose(void);
+
+#endif /* __POSE_H */
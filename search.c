@@ -1,5 +1,7 @@
 #include "search.h"
 
+#define FRONTIER_STACKS 3
+
 static uint8_t distances[MAZE_SIZE * MAZE_SIZE];
 static uint8_t maze_walls[MAZE_SIZE * MAZE_SIZE];
 
@@ -14,6 +16,11 @@ static struct data_queue {
 	int tail;
 } queue;
 
+static struct data_stack {
+	uint8_t buffer[MAZE_AREA];
+	int size;
+} frontier[FRONTIER_STACKS];
+
 struct cells_stack {
 	int cells[MAX_TARGETS];
 	uint8_t size;
@@ -22,6 +29,8 @@ struct cells_stack {
 static struct cells_stack goal_cells;
 static struct cells_stack target_cells;
 
+static enum exploration_strategy_type exploration_strategy;
+
 static void queue_push(uint8_t data)
 {
 	queue.buffer[queue.head++] = data;
@@ -32,6 +41,16 @@ static uint8_t queue_pop(void)
 	return queue.buffer[queue.tail++];
 }
 
+static void stack_push(struct data_stack *stack, uint8_t data)
+{
+	stack->buffer[stack->size++] = data;
+}
+
+static uint8_t stack_pop(struct data_stack *stack)
+{
+	return stack->buffer[--stack->size];
+}
+
 uint8_t read_cell_distance_value(uint8_t cell)
 {
 	return distances[cell];
@@ -78,6 +97,14 @@ void set_target_cell(uint8_t cell)
 	add_target(cell);
 }
 
+/**
+ * @brief Return the first target cell.
+ */
+uint8_t search_target(void)
+{
+	return target_cells.cells[0];
+}
+
 /**
  * @brief Set the goal as target.
  */
@@ -101,6 +128,18 @@ void set_search_initial_state(void)
 	current_direction = initial_direction;
 }
 
+/**
+ * @brief Set the current search position and direction.
+ *
+ * @param[in] position Cell to set as current position.
+ * @param[in] direction Direction to set as current direction.
+ */
+void set_search_position(uint8_t position, enum compass_direction direction)
+{
+	current_position = position;
+	current_direction = direction;
+}
+
 static enum compass_direction next_compass_direction(enum step_direction step)
 {
 	if (step == LEFT) {
@@ -318,15 +357,23 @@ enum step_direction best_neighbor_step(struct walls_around walls)
 	return BACK;
 }
 
-static void queue_push_breath(uint8_t cell, uint8_t distance)
+static void queue_push_breath(uint8_t cell, uint8_t distance,
+			      uint8_t required_bits)
 {
 	if (distances[cell] <= distance)
 		return;
+	if ((maze_walls[cell] & required_bits) != required_bits)
+		return;
 	distances[cell] = distance;
 	queue_push(cell);
 }
 
-static void update_distances_breath(void)
+/**
+ * @brief Flood the maze distances from the cells in the queue.
+ *
+ * @param[in] required_bits Cell bits required to flood through a cell.
+ */
+static void update_distances_breath(uint8_t required_bits)
 {
 	uint8_t cell;
 	uint8_t distance;
@@ -335,13 +382,15 @@ static void update_distances_breath(void)
 		cell = queue_pop();
 		distance = distances[cell] + 1;
 		if (!wall_exists(cell, EAST_BIT))
-			queue_push_breath(cell + EAST, distance);
+			queue_push_breath(cell + EAST, distance, required_bits);
 		if (!wall_exists(cell, SOUTH_BIT))
-			queue_push_breath(cell + SOUTH, distance);
+			queue_push_breath(cell + SOUTH, distance,
+					  required_bits);
 		if (!wall_exists(cell, WEST_BIT))
-			queue_push_breath(cell + WEST, distance);
+			queue_push_breath(cell + WEST, distance, required_bits);
 		if (!wall_exists(cell, NORTH_BIT))
-			queue_push_breath(cell + NORTH, distance);
+			queue_push_breath(cell + NORTH, distance,
+					  required_bits);
 	}
 }
 
@@ -362,20 +411,141 @@ static void _reset_distances_and_queue(void)
 }
 
 /**
- * @brief Set maze distances with respect to the target.
+ * @brief Push the target cells to the queue, with zero distance.
  */
-void set_distances(void)
+static void _push_targets(void)
 {
 	int i;
 	int cell;
 
-	_reset_distances_and_queue();
 	for (i = 0; i < target_cells.size; i++) {
 		cell = target_cells.cells[i];
 		distances[cell] = 0;
 		queue_push(cell);
 	}
-	update_distances_breath();
+}
+
+/**
+ * @brief Set maze distances with respect to the target.
+ */
+void set_distances(void)
+{
+	_reset_distances_and_queue();
+	_push_targets();
+	update_distances_breath(0);
+}
+
+/**
+ * @brief Set maze distances with respect to the target, only through cells
+ * that have already been visited.
+ *
+ * This is the best that can be done with the walls that are known for sure.
+ */
+void set_visited_distances(void)
+{
+	_reset_distances_and_queue();
+	_push_targets();
+	update_distances_breath(VISITED_BIT);
+}
+
+/**
+ * @brief Return the Manhattan distance between two cells.
+ */
+static uint8_t manhattan_distance(uint8_t cell, uint8_t other)
+{
+	return abs(cell % MAZE_SIZE - other % MAZE_SIZE) +
+	       abs(cell / MAZE_SIZE - other / MAZE_SIZE);
+}
+
+/**
+ * @brief Return the estimated route length through a cell.
+ *
+ * That is the distance from the target to the cell plus the Manhattan
+ * distance from the cell to the current position.
+ */
+static int route_estimate(uint8_t cell)
+{
+	return distances[cell] + manhattan_distance(cell, current_position);
+}
+
+/**
+ * @brief Label a cell while searching the route to the current position.
+ *
+ * Cells are pushed to the frontier stack that corresponds to their estimated
+ * route length. Expanding a cell can only result in the same estimate or two
+ * more, so three stacks are enough to hold all the frontier.
+ */
+static void push_route(uint8_t cell, uint8_t distance)
+{
+	if (distances[cell] <= distance)
+		return;
+	distances[cell] = distance;
+	stack_push(&frontier[route_estimate(cell) % FRONTIER_STACKS], cell);
+}
+
+/**
+ * @brief Set maze distances with respect to the target, only as far as needed
+ * to reach the current position.
+ *
+ * This is an A* search from the target cells towards the current position,
+ * guided by the Manhattan distance. Cells are expanded by increasing estimated
+ * route length and, among those with the same estimate, the deepest first,
+ * which heads straight to the current position on open maps. The search stops
+ * as soon as the current position is settled.
+ *
+ * Cells that were not reached keep `MAX_DISTANCE`. Distances along the route
+ * are exact, so `best_neighbor_step()` and `search_distance()` behave as after
+ * a full `set_distances()` while following it.
+ *
+ * @return Whether the current position can reach the target or not.
+ */
+bool set_route_distances(void)
+{
+	int i;
+	int bound;
+	int pending;
+	uint8_t cell;
+	uint8_t distance;
+	struct data_stack *current;
+
+	for (i = 0; i < MAZE_AREA; i++)
+		distances[i] = MAX_DISTANCE;
+	for (i = 0; i < FRONTIER_STACKS; i++)
+		frontier[i].size = 0;
+	pending = target_cells.size;
+
+	for (bound = 0; true; bound++) {
+		current = &frontier[bound % FRONTIER_STACKS];
+		/* Targets join the search when their estimate is reached */
+		for (i = 0; i < target_cells.size; i++) {
+			cell = target_cells.cells[i];
+			if (manhattan_distance(cell, current_position) != bound)
+				continue;
+			distances[cell] = 0;
+			stack_push(current, cell);
+			pending--;
+		}
+		while (current->size) {
+			cell = stack_pop(current);
+			/* Skip cells that were relabeled after being pushed */
+			if (route_estimate(cell) != bound)
+				continue;
+			if (cell == current_position)
+				return true;
+			distance = distances[cell] + 1;
+			if (!wall_exists(cell, EAST_BIT))
+				push_route(cell + EAST, distance);
+			if (!wall_exists(cell, SOUTH_BIT))
+				push_route(cell + SOUTH, distance);
+			if (!wall_exists(cell, WEST_BIT))
+				push_route(cell + WEST, distance);
+			if (!wall_exists(cell, NORTH_BIT))
+				push_route(cell + NORTH, distance);
+		}
+		if (!pending && !frontier[(bound + 1) % FRONTIER_STACKS].size &&
+		    !frontier[(bound + 2) % FRONTIER_STACKS].size)
+			return false;
+	}
 }
 
 void move_search_position(enum step_direction step)
@@ -433,11 +603,20 @@ struct walls_around current_walls_around(void)
 }
 
 /**
- * @brief Find an unexplored and potentially interesting cell.
+ * @brief Return the route from the current position to the target.
+ *
+ * The route is generated following the current maze distances on the known
+ * walls. The current position and direction are left untouched.
+ *
+ * @param[out] cells Array to write the route cells to (excluding the current
+ * position).
+ * @param[in] max_cells Maximum number of cells to write.
+ *
+ * @return The number of cells in the route.
  */
-uint8_t find_unexplored_interesting_cell(void)
+int search_route(uint8_t *cells, int max_cells)
 {
-	uint8_t interesting = 0;
+	int length = 0;
 	uint8_t backed_up_position;
 	enum compass_direction backed_up_direction;
 	enum step_direction step;
@@ -446,20 +625,136 @@ uint8_t find_unexplored_interesting_cell(void)
 	backed_up_position = current_position;
 	backed_up_direction = current_direction;
 
-	set_search_initial_state();
-	set_target_goal();
-	set_distances();
-	while (search_distance() > 0) {
+	while (search_distance() > 0 && length < max_cells) {
 		step = best_neighbor_step(current_walls_around());
-		move_search_position(step);
-		if (!current_cell_is_visited()) {
-			interesting = current_position;
+		if (step == BACK &&
+		    distances[next_step_position(BACK)] >= search_distance())
 			break;
-		}
+		move_search_position(step);
+		cells[length++] = current_position;
 	}
 
 	/* Recover backed up position and direction */
 	current_position = backed_up_position;
 	current_direction = backed_up_direction;
-	return interesting;
+	return length;
+}
+
+/**
+ * @brief Find an unexplored and potentially interesting cell.
+ *
+ * That is the first not-yet-visited cell in the route from the start to the
+ * goal, as it currently looks like.
+ */
+uint8_t find_unexplored_interesting_cell(void)
+{
+	int i;
+	int length;
+	uint8_t route[MAZE_AREA];
+	uint8_t backed_up_position;
+	enum compass_direction backed_up_direction;
+
+	/* Back up position and direction */
+	backed_up_position = current_position;
+	backed_up_direction = current_direction;
+
+	set_search_initial_state();
+	set_target_goal();
+	set_route_distances();
+	length = search_route(route, MAZE_AREA);
+
+	/* Recover backed up position and direction */
+	current_position = backed_up_position;
+	current_direction = backed_up_direction;
+
+	for (i = 0; i < length; i++) {
+		if (!(maze_walls[route[i]] & VISITED_BIT))
+			return route[i];
+	}
+	return 0;
+}
+
+/**
+ * @brief Return the best step, preferring neighbors not yet visited.
+ *
+ * Among the neighbors closer to the target, unvisited ones are preferred so
+ * that each step is more likely to discover new walls. Ties are broken with
+ * the usual front-left-right preference.
+ */
+static enum step_direction
+best_unvisited_neighbor_step(struct walls_around walls)
+{
+	int i;
+	uint8_t position;
+	enum step_direction steps[3] = {FRONT, LEFT, RIGHT};
+	bool blocked[3] = {walls.front, walls.left, walls.right};
+
+	for (i = 0; i < 3; i++) {
+		if (blocked[i])
+			continue;
+		position = next_step_position(steps[i]);
+		if (distances[position] >= search_distance())
+			continue;
+		if (!(maze_walls[position] & VISITED_BIT))
+			return steps[i];
+	}
+	return best_neighbor_step(walls);
+}
+
+/**
+ * @brief Target the first unexplored cell in the best route to the goal.
+ *
+ * When there are no more unexplored cells, target the start.
+ */
+static void set_target_unexplored(void)
+{
+	set_target_cell(find_unexplored_interesting_cell());
+}
+
+/**
+ * @brief Target the start cell.
+ */
+static void set_target_start(void)
+{
+	set_target_cell(0);
+}
+
+/**
+ * @brief Whether the current position is the start cell or not.
+ */
+static bool returned_to_start(void)
+{
+	return current_position == 0;
+}
+
+// clang-format off
+static const struct exploration_strategy strategies[] = {
+    [EXPLORATION_DEFAULT] = {
+	set_target_unexplored, best_neighbor_step, returned_to_start,
+    },
+    [EXPLORATION_UNVISITED_FIRST] = {
+	set_target_unexplored, best_unvisited_neighbor_step, returned_to_start,
+    },
+    [EXPLORATION_GOAL_AND_BACK] = {
+	set_target_start, best_neighbor_step, returned_to_start,
+    },
+};
+// clang-format on
+
+/**
+ * @brief Select the exploration strategy to use.
+ *
+ * @param[in] type Exploration strategy type.
+ */
+void set_exploration_strategy(enum exploration_strategy_type type)
+{
+	exploration_strategy = type;
+}
+
+/**
+ * @brief Return the selected exploration strategy.
+ */
+const struct exploration_strategy *get_exploration_strategy(void)
+{
+	return &strategies[exploration_strategy];
 }
@@ -32,12 +32,33 @@ struct walls_around {
 
 enum step_direction { NONE = -1, LEFT = 0, FRONT = 1, RIGHT = 2, BACK = 3 };
 
+enum exploration_strategy_type {
+	EXPLORATION_DEFAULT,         /**< Explore the best route unknowns */
+	EXPLORATION_UNVISITED_FIRST, /**< Prefer unvisited cells on ties */
+	EXPLORATION_GOAL_AND_BACK,   /**< Reach the goal and return */
+	EXPLORATION_STRATEGIES_COUNT,
+};
+
+/**
+ * Exploration strategy.
+ *
+ * - Set the next target once the current one has been reached.
+ * - Choose the step to take, among the neighbors closer to the target.
+ * - Whether the exploration is finished after reaching a target.
+ */
+struct exploration_strategy {
+	void (*set_next_target)(void);
+	enum step_direction (*best_step)(struct walls_around walls);
+	bool (*finished)(void);
+};
+
 uint8_t read_cell_distance_value(uint8_t cell);
 uint8_t read_cell_walls_value(uint8_t cell);
 void add_goal(int x, int y);
 void set_goal_classic(void);
 void set_search_initial_direction(enum compass_direction direction);
 void set_search_initial_state(void);
+void set_search_position(uint8_t position, enum compass_direction direction);
 enum compass_direction search_direction(void);
 bool current_side_wall(enum step_direction side);
 void move_search_position(enum step_direction step);
@@ -47,11 +68,17 @@ uint8_t search_distance(void);
 enum step_direction search_step(bool left, bool front, bool right);
 void initialize_maze_walls(void);
 void set_distances(void);
+void set_visited_distances(void);
+bool set_route_distances(void);
 void set_target_cell(uint8_t cell);
 void set_target_goal(void);
+uint8_t search_target(void);
 void update_walls(struct walls_around walls);
 bool current_cell_is_visited(void);
 struct walls_around current_walls_around(void);
+int search_route(uint8_t *cells, int max_cells);
 uint8_t find_unexplored_interesting_cell(void);
+void set_exploration_strategy(enum exploration_strategy_type type);
+const struct exploration_strategy *get_exploration_strategy(void);
 
 #endif /* __SEARCH_H */
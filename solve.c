@@ -3,39 +3,360 @@
 #define RUN_SEQUENCE_LEN (MAZE_AREA + 3)
 #define EEPROM_NUM_BYTES_ERASED_CHECKED ((uint8_t)4)
 #define EEPROM_BYTE_ERASED_VALUE 255
+#define RUN_ALTERNATIVES 3
+#define RUN_ALTERNATIVES_SLACK 2
+#define MAX_RUN_CANDIDATES 128
+#define MAX_COLLISION_RECOVERIES 3
 static char run_sequence[RUN_SEQUENCE_LEN];
+static struct path_segment run_path[RUN_SEQUENCE_LEN];
+static enum path_language run_language = PATH_DIAGONALS;
+
+/* Collisions recovered from in the current exploration or run */
+static int collision_recoveries;
+
+/* Exploration time budget, in seconds (zero means unlimited) */
+static float exploration_budget;
+static uint32_t exploration_start;
+
+/**
+ * Run path compilation state.
+ *
+ * - Index of the next raw run sequence step to translate.
+ * - Number of segments in the run path.
+ * - Raw path translator.
+ */
+static struct run_compiler {
+	int raw;
+	int length;
+	struct path_translator translator;
+} compiler;
+
+/**
+ * Alternative run sequences, ranked by predicted time.
+ */
+static struct run_alternatives {
+	char sequence[RUN_ALTERNATIVES][RUN_SEQUENCE_LEN];
+	float time[RUN_ALTERNATIVES];
+	int count;
+	int selected;
+} alternatives;
+
+/**
+ * Depth-first route search state, for each step in the route.
+ *
+ * - Cell position and direction.
+ * - Next step to try from that cell.
+ * - Raw step taken to reach that cell.
+ * - Cells currently in the route, as a bitmap.
+ */
+static struct route_search {
+	uint8_t position[RUN_SEQUENCE_LEN];
+	int8_t direction[RUN_SEQUENCE_LEN];
+	uint8_t next_try[RUN_SEQUENCE_LEN];
+	char step[RUN_SEQUENCE_LEN];
+	uint32_t in_route[MAZE_AREA / 32];
+} route;
+
+/**
+ * @brief Reset the run path compilation state.
+ */
+static void reset_run_compiler(void)
+{
+	compiler.raw = 0;
+	compiler.length = 0;
+	reset_path_translator(&compiler.translator, run_language);
+}
+
+/**
+ * @brief Compile the raw run sequence into the run path as it grows.
+ *
+ * Movements are translated as soon as the raw steps read so far resolve them,
+ * so the run path is complete right after walking the distance gradient and
+ * `run()` does not need to parse the raw sequence at all.
+ *
+ * @param[in] length Number of raw steps available in the run sequence,
+ * including the null terminator once the sequence is complete.
+ */
+static void compile_run_sequence(int length)
+{
+	int i;
+	int count;
+	enum movement emitted[PATH_LOOKAHEAD];
+
+	while (compiler.raw < length) {
+		count = translate_raw_step(&compiler.translator,
+					   run_sequence[compiler.raw], emitted);
+		for (i = 0; i < count; i++)
+			compiler.length = append_path_segment(
+			    run_path, compiler.length, emitted[i]);
+		if (run_sequence[compiler.raw++] == '\0')
+			append_path_segment(run_path, compiler.length,
+					    MOVE_END);
+	}
+}
+
+/**
+ * @brief Try to recover from a collision.
+ *
+ * The number of recoveries is limited, as a mouse that keeps colliding is
+ * probably lost or damaged.
+ *
+ * @return Whether the mouse recovered and movements can be resumed.
+ */
+static bool recover(void)
+{
+	if (collision_recoveries >= MAX_COLLISION_RECOVERIES)
+		return false;
+	collision_recoveries++;
+	LOG_WARNING("Recovering from collision!");
+	return recover_from_collision();
+}
 
 /**
  * @brief Move from the current position to the defined target.
  *
+ * Recoverable collisions do not abort the movement, which is resumed from the
+ * cell where the mouse recovered.
+ *
  * @param[in] force Maximum force to apply on the tires.
+ *
+ * @return Whether the target was reached.
  */
-static void go_to_target(float force)
+static bool go_to_target(float force)
 {
 	enum step_direction step;
 	struct walls_around walls;
+	const struct exploration_strategy *strategy;
 
-	set_distances();
+	strategy = get_exploration_strategy();
+
+	set_route_distances();
 	do {
 		if (!current_cell_is_visited()) {
 			walls = read_walls();
 			update_walls(walls);
-			set_distances();
+			set_route_distances();
 		} else {
 			walls = current_walls_around();
 		}
 #ifdef MMSIM_SIMULATION
 		send_state();
 #endif
-		step = best_neighbor_step(walls);
+		step = strategy->best_step(walls);
 		move_search_position(step);
 		move(step, force);
-		if (collision_detected())
-			return;
+		if (collision_detected()) {
+			if (!recover())
+				return false;
+			set_route_distances();
+		}
 	} while (search_distance() > 0);
 
 	walls = read_walls();
 	update_walls(walls);
+	return true;
+}
+
+/**
+ * @brief Walk the distance gradient from the start to the goal.
+ *
+ * @param[out] sequence Raw sequence of the steps walked.
+ * @param[in] compile Whether to compile the run path while walking, only
+ * valid when walking into the run sequence.
+ */
+static void walk_gradient(char *sequence, bool compile)
+{
+	int i = 0;
+	enum step_direction step;
+
+	set_search_initial_state();
+	sequence[i++] = 'B';
+	while (search_distance() > 0) {
+		step = best_neighbor_step(current_walls_around());
+		switch (step) {
+		case FRONT:
+			sequence[i++] = 'F';
+			break;
+		case LEFT:
+			sequence[i++] = 'L';
+			break;
+		case RIGHT:
+			sequence[i++] = 'R';
+			break;
+		default:
+			break;
+		}
+		move_search_position(step);
+		if (compile)
+			compile_run_sequence(i);
+	}
+	while (true) {
+		move_search_position(FRONT);
+		if (search_distance() != 0)
+			break;
+		sequence[i++] = 'F';
+	}
+	sequence[i++] = 'F';
+	sequence[i++] = 'S';
+	sequence[i] = '\0';
+	if (compile)
+		compile_run_sequence(i + 1);
+}
+
+/**
+ * @brief Make sure the run path keeps clear of posts and known walls.
+ *
+ * While any segment of the run path sweeps too close to a post or a wall, the
+ * run sequence is translated again with a safer language, down to the safe
+ * one.
+ */
+static void check_run_path_clearance(void)
+{
+	int unsafe;
+	enum path_language language = run_language;
+
+	set_search_initial_state();
+	while (true) {
+		unsafe = find_unsafe_segment(run_path, search_position(),
+					     search_direction());
+		if (unsafe < 0 || language == PATH_SAFE)
+			break;
+		LOG_WARNING("Unsafe run path segment %d, downgrading", unsafe);
+		if (language == PATH_AGGRESSIVE)
+			language = PATH_DIAGONALS;
+		else
+			language = PATH_SAFE;
+		make_smooth_segments(run_sequence, run_path, language);
+	}
+	if (unsafe >= 0)
+		LOG_ERROR("Unsafe run path segment %d", unsafe);
+}
+
+/**
+ * @brief Define the movement sequence to be executed on speed runs.
+ *
+ * The run path is compiled while walking the distance gradient, then checked
+ * for clearance against posts and known walls.
+ */
+void set_run_sequence(void)
+{
+	set_target_goal();
+	set_distances();
+	reset_run_compiler();
+	alternatives.count = 0;
+	walk_gradient(run_sequence, true);
+	check_run_path_clearance();
+}
+
+/**
+ * @brief Set the language used to translate the run sequence.
+ *
+ * The current run path, if any, is translated again with the new language.
+ *
+ * @param[in] language Path language to use on speed runs.
+ */
+void set_run_language(enum path_language language)
+{
+	run_language = language;
+	if (run_sequence[0] == '\0')
+		return;
+	make_smooth_segments(run_sequence, run_path, run_language);
+	check_run_path_clearance();
+}
+
+/**
+ * @brief Set the time budget for the exploration.
+ *
+ * The budget is counted from the start of the exploration and should be the
+ * competition time left at that moment, so that exploring stops when it is no
+ * longer worth it and more time is left for speed runs.
+ *
+ * @param[in] seconds Time budget, in seconds (zero means unlimited).
+ */
+void set_exploration_budget(float seconds)
+{
+	exploration_budget = seconds;
+}
+
+/**
+ * @brief Predict the run time following the current distance gradient.
+ *
+ * @param[in] force Maximum force to apply on the tires while running.
+ *
+ * @return The predicted time, in seconds, or a negative value if the goal
+ * can not be reached.
+ */
+static float predict_gradient_time(float force)
+{
+	char sequence[RUN_SEQUENCE_LEN];
+
+	set_search_initial_state();
+	if (search_distance() == MAX_DISTANCE)
+		return -1.;
+	walk_gradient(sequence, false);
+	return estimate_path_time(sequence, run_language, force, NULL);
+}
+
+/**
+ * @brief Decide whether probing the current target is worth it or not.
+ *
+ * The gain is the difference between the run time on visited cells only and
+ * the (optimistic) run time assuming unknown walls do not exist, applied to
+ * all the runs (and returns) that fit in the time left. The cost is the
+ * detour to the target before going back to the start, assuming each cell
+ * takes as much as travelling it at the search linear speed.
+ *
+ * Search position, direction and target are preserved.
+ *
+ * @param[in] force Maximum force to apply on the tires while running.
+ *
+ * @return Whether the gain pays for the probe cost.
+ */
+static bool probe_pays_off(float force)
+{
+	uint8_t target;
+	uint8_t position;
+	enum compass_direction direction;
+	float cell_time;
+	float remaining;
+	float optimistic;
+	float known;
+	float home_now;
+	float detour;
+	float runs;
+
+	target = search_target();
+	if (target == 0)
+		return true;
+	position = search_position();
+	direction = search_direction();
+	cell_time = CELL_DIMENSION / get_max_linear_speed();
+	remaining = exploration_budget -
+		    (float)(get_clock_ticks() - exploration_start) /
+			SYSTICK_FREQUENCY_HZ;
+
+	set_target_cell(0);
+	set_distances();
+	home_now = search_distance() * cell_time;
+	detour = read_cell_distance_value(target) * cell_time;
+	set_target_cell(target);
+	set_route_distances();
+	detour += search_distance() * cell_time;
+
+	set_target_goal();
+	set_distances();
+	optimistic = predict_gradient_time(force);
+	set_visited_distances();
+	known = predict_gradient_time(force);
+
+	set_search_position(position, direction);
+	set_target_cell(target);
+	if (detour > remaining)
+		return false;
+	if (known < 0.)
+		return true;
+	runs = (remaining - home_now) / (2 * known);
+	return (known - optimistic) * runs > detour - home_now;
 }
 
 /**
@@ -43,83 +364,238 @@ static void go_to_target(float force)
  *
  * @param[in] force Maximum force to apply on the tires.
  *
- * After reaching the goal, it will try to explore remaining parts until
- * finding an optimal path.
+ * After reaching the goal, it will keep setting new targets according to the
+ * selected exploration strategy until the strategy considers it finished. The
+ * default strategy explores remaining parts until finding an optimal path.
+ *
+ * With an exploration time budget set, each new target is only probed if the
+ * expected run time gain pays for it, otherwise the mouse returns to start.
+ *
+ * The collision detected signal is left set if the exploration was aborted
+ * by a collision the mouse could not recover from.
  */
 void explore(float force)
 {
-	uint8_t cell;
+	const struct exploration_strategy *strategy;
 
 	initialize_maze_walls();
 	set_search_initial_state();
+	strategy = get_exploration_strategy();
+	exploration_start = get_clock_ticks();
+	collision_recoveries = 0;
 
 	while (true) {
-		go_to_target(force);
-		if (collision_detected())
+		if (!go_to_target(force))
 			return;
-		if (search_position() == 0)
+		if (strategy->finished())
 			break;
-		cell = find_unexplored_interesting_cell();
-		set_target_cell(cell);
+		strategy->set_next_target();
+		if (exploration_budget > 0. && !probe_pays_off(force))
+			set_target_cell(0);
 	}
 	stop_middle();
 	turn_to_start_position(force);
 }
 
 /**
- * @brief Define the movement sequence to be executed on speed runs.
+ * @brief Add a candidate run sequence to the ranked alternatives.
+ *
+ * The candidate is discarded if there are enough faster alternatives.
+ *
+ * @param[in] sequence Raw run sequence.
+ * @param[in] time Predicted time for the sequence.
  */
-void set_run_sequence(void)
+static void rank_run_alternative(char *sequence, float time)
+{
+	int i;
+
+	if (alternatives.count == RUN_ALTERNATIVES &&
+	    time >= alternatives.time[RUN_ALTERNATIVES - 1])
+		return;
+	if (alternatives.count < RUN_ALTERNATIVES)
+		alternatives.count++;
+	for (i = alternatives.count - 1; i > 0; i--) {
+		if (alternatives.time[i - 1] <= time)
+			break;
+		alternatives.time[i] = alternatives.time[i - 1];
+		strcpy(alternatives.sequence[i], alternatives.sequence[i - 1]);
+	}
+	alternatives.time[i] = time;
+	strcpy(alternatives.sequence[i], sequence);
+}
+
+/**
+ * @brief Build the raw run sequence for the route found so far.
+ *
+ * The route must end in a goal cell. Like in `set_run_sequence()`, the
+ * sequence goes straight through any other goal cells in front.
+ *
+ * @param[in] depth Number of steps in the route.
+ * @param[out] sequence Raw run sequence.
+ */
+static void build_route_sequence(int depth, char *sequence)
 {
 	int i = 0;
+
+	sequence[i++] = 'B';
+	memcpy(&sequence[i], route.step, depth);
+	i += depth;
+	while (true) {
+		move_search_position(FRONT);
+		if (search_distance() != 0)
+			break;
+		sequence[i++] = 'F';
+	}
+	sequence[i++] = 'F';
+	sequence[i++] = 'S';
+	sequence[i] = '\0';
+}
+
+/**
+ * @brief Select a ranked run alternative as the run sequence.
+ *
+ * @param[in] index Alternative index, in ranking order.
+ */
+static void select_run_alternative(int index)
+{
+	alternatives.selected = index;
+	strcpy(run_sequence, alternatives.sequence[index]);
+	make_smooth_segments(run_sequence, run_path, run_language);
+	check_run_path_clearance();
+}
+
+/**
+ * @brief Find the fastest run sequences on the known map.
+ *
+ * Routes from the start to the goal up to `RUN_ALTERNATIVES_SLACK` cells
+ * longer than the shortest one are explored (depth-first, with a limit of
+ * `MAX_RUN_CANDIDATES` complete routes) and ranked by predicted time. A
+ * slightly longer route may be faster if it has fewer or softer turns.
+ *
+ * The fastest alternative is selected as the run sequence. If no alternative
+ * is found, the run sequence built by `set_run_sequence()` is kept.
+ *
+ * @param[in] force Maximum force to apply on the tires while running.
+ */
+void set_run_alternatives(float force)
+{
+	int depth = 0;
+	int candidates = 0;
+	int bound;
+	float time;
+	char sequence[RUN_SEQUENCE_LEN];
+	uint8_t cell;
 	enum step_direction step;
+	const enum step_direction steps[] = {FRONT, LEFT, RIGHT};
+	const char raw_steps[] = {'F', 'L', 'R'};
 
+	alternatives.count = 0;
 	set_search_initial_state();
 	set_target_goal();
 	set_distances();
+	if (search_distance() == MAX_DISTANCE)
+		return;
+	bound = search_distance() + RUN_ALTERNATIVES_SLACK;
 
-	run_sequence[i++] = 'B';
-	while (search_distance() > 0) {
-		step = best_neighbor_step(current_walls_around());
-		switch (step) {
-		case FRONT:
-			run_sequence[i++] = 'F';
-			break;
-		case LEFT:
-			run_sequence[i++] = 'L';
-			break;
-		case RIGHT:
-			run_sequence[i++] = 'R';
-			break;
-		default:
-			break;
+	memset(route.in_route, 0, sizeof(route.in_route));
+	route.position[0] = search_position();
+	route.direction[0] = search_direction();
+	route.next_try[0] = 0;
+	route.in_route[route.position[0] / 32] |= 1u << route.position[0] % 32;
+	while (depth >= 0 && candidates < MAX_RUN_CANDIDATES) {
+		set_search_position(route.position[depth],
+				    route.direction[depth]);
+		if (search_distance() == 0 || route.next_try[depth] == 3) {
+			if (search_distance() == 0) {
+				build_route_sequence(depth, sequence);
+				time = estimate_path_time(
+				    sequence, run_language, force, NULL);
+				rank_run_alternative(sequence, time);
+				candidates++;
+			}
+			cell = route.position[depth--];
+			route.in_route[cell / 32] &= ~(1u << cell % 32);
+			continue;
 		}
+		step = steps[route.next_try[depth]];
+		route.step[depth] = raw_steps[route.next_try[depth]++];
+		if (current_side_wall(step))
+			continue;
 		move_search_position(step);
+		cell = search_position();
+		if (route.in_route[cell / 32] & (1u << cell % 32))
+			continue;
+		if (depth + 1 + search_distance() > bound)
+			continue;
+		depth++;
+		route.position[depth] = cell;
+		route.direction[depth] = search_direction();
+		route.next_try[depth] = 0;
+		route.in_route[cell / 32] |= 1u << cell % 32;
 	}
-	while (true) {
-		move_search_position(FRONT);
-		if (search_distance() != 0)
-			break;
-		run_sequence[i++] = 'F';
-	}
-	run_sequence[i++] = 'F';
-	run_sequence[i++] = 'S';
-	run_sequence[i] = '\0';
+	set_search_initial_state();
+	if (alternatives.count > 0)
+		select_run_alternative(0);
+}
+
+/**
+ * @brief Select the next ranked run alternative as the run sequence.
+ *
+ * @return Whether there was a next alternative to select or not.
+ */
+bool select_next_run_alternative(void)
+{
+	if (alternatives.selected + 1 >= alternatives.count)
+		return false;
+	select_run_alternative(alternatives.selected + 1);
+	return true;
+}
+
+/**
+ * @brief Resume a run, after recovering from a collision, with search moves.
+ *
+ * The mouse goes on to the target and then turns to a starting position. This
+ * leaves the kinematic configuration in search mode.
+ *
+ * @param[in] force Maximum force to apply on the tires.
+ */
+static void resume_run(float force)
+{
+	kinematic_configuration(force, false);
+	if (!go_to_target(force))
+		return;
+	stop_middle();
+	turn_to_start_position(force);
 }
 
 /**
  * @brief Run from the start to the goal.
  *
+ * If the run fails, the next ranked run alternative (if any) is selected for
+ * the next attempt, and the run is resumed if the mouse can recover from the
+ * collision. The collision detected signal is left set if it could not.
+ *
  * @param[in] force Maximum force to apply on the tires.
  */
 void run(float force)
 {
-	execute_movement_sequence(run_sequence, force, PATH_DIAGONALS);
+	collision_recoveries = 0;
+	execute_movement_path(run_path, force);
+	if (!collision_detected())
+		return;
+	select_next_run_alternative();
+	if (!recover())
+		return;
+	set_target_goal();
+	resume_run(force);
 }
 
 /**
  * @brief Run back from the goal to the start.
  *
+ * The run back is resumed if the mouse can recover from a collision. The
+ * collision detected signal is left set if it could not.
+ *
  * @param[in] force Maximum force to apply on the tires.
  */
 void run_back(float force)
@@ -152,7 +628,12 @@ void run_back(float force)
 		run_back[length - i - 1] = translation;
 	}
 	run_back[length] = '\0';
+	collision_recoveries = 0;
 	execute_movement_sequence(run_back, force, PATH_SAFE);
+	if (!collision_detected() || !recover())
+		return;
+	set_target_cell(0);
+	resume_run(force);
 }
 
 /**
@@ -176,6 +657,8 @@ void load_maze(void)
 {
 	eeprom_read_data(FLASH_EEPROM_ADDRESS_MAZE, MAZE_AREA,
 			 (uint8_t *)run_sequence);
+	make_smooth_segments(run_sequence, run_path, run_language);
+	check_run_path_clearance();
 }
 
 /**
@@ -1,6 +1,7 @@
 #ifndef __SOLVE_H
 #define __SOLVE_H
 
+#include "mmlib/clearance.h"
 #include "mmlib/logging.h"
 #include "mmlib/move.h"
 #include "mmlib/path.h"
@@ -11,10 +12,14 @@
 #include "setup.h"
 
 void explore(float force);
+void set_exploration_budget(float seconds);
 #ifdef MMSIM_SIMULATION
 void send_state(void);
 #endif
+void set_run_language(enum path_language language);
 void set_run_sequence(void);
+void set_run_alternatives(float force);
+bool select_next_run_alternative(void);
 void run(float force);
 void run_back(float force);
 void save_maze(void);
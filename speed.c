@@ -1,13 +1,42 @@
 #include "speed.h"
 
+/* Number of steps of the turn transition ramp table */
+#define TURN_RAMP_STEPS 64
+/* Number of turn types, which are the first movements */
+#define TURNS_COUNT (MOVE_RIGHT_DIAGONAL + 1)
+/* Number of integration steps used to design a turn */
+#define TURN_DESIGN_STEPS 256
+/* Number of bisection iterations used to design a 180 degree turn */
+#define TURN_DESIGN_ITERATIONS 24
+/* Number of bisection iterations used to plan jerk-limited straight speeds */
+#define SPEED_SEARCH_ITERATIONS 16
+/* Number of force ranges with their own learned turn corrections */
+#define LEARNING_FORCE_BINS 4
+/* Width of each force range with its own learned turn corrections */
+#define LEARNING_FORCE_STEP 0.25
+/* Fraction of each turn exit error that is learned */
+#define LEARNING_RATE 0.25
+/* Maximum learned turn correction, in meters */
+#define LEARNING_MAX_CORRECTION 0.02
+/* Marks valid learned turn corrections when persisted */
+#define LEARNING_MAGIC 0x4C524E54
+
 /**
  * Speed module static variables.
  *
  * - Maximum force applied on the tires.
+ * - Force ratio applied when accelerating in straight lines.
+ * - Force ratio applied when braking in straight lines.
  * - Maximum linear speed.
+ * - Maximum linear jerk, zero for trapezoidal speed profiles.
+ * - Per-movement force overrides, zero to use the maximum force.
  */
 static volatile float max_force;
+static volatile float acceleration_force_ratio = 1.;
+static volatile float braking_force_ratio = 1.;
 static volatile float max_linear_speed;
+static volatile float max_linear_jerk;
+static float movement_forces[MOVE_NONE];
 
 /**
  * Parameters that define a turn.
@@ -18,6 +47,8 @@ static volatile float max_linear_speed;
  * - Duration, in meters, of the angular acceleration phase
  * - Duration, in meters, of the constant angular velocity phase
  * - Sign of the turn (left or right)
+ * - Shape of the transition phases
+ * - Turn angle, in radians
  */
 struct turn_parameters {
 	float before;
@@ -26,8 +57,288 @@ struct turn_parameters {
 	float transition;
 	float arc;
 	int sign;
+	enum turn_transition shape;
+	float angle;
+};
+
+/**
+ * High-level definition of a left turn, right turns are its mirror.
+ *
+ * - Whether the turn starts on a diagonal.
+ * - Turn angle, in degrees.
+ * - Corridors the turn moves aside, only for 180 degree turns.
+ * - Curve minimum radius, derived for 180 degree turns.
+ * - Straight distance before and after 180 degree turns.
+ * - Duration, in meters, of the angular acceleration phase.
+ * - Shape of the transition phases.
+ */
+struct turn_design {
+	bool diagonal;
+	int degrees;
+	int span;
+	float radius;
+	float straight;
+	float transition;
+	enum turn_transition shape;
 };
 
+/**
+ * Turn profile, precomputed from the turn parameters.
+ *
+ * - End of the first transition phase, in micrometers.
+ * - End of the constant angular velocity phase, in micrometers.
+ * - Turn length, in micrometers.
+ * - Inverse of the transition length, in inverse micrometers.
+ * - Shape of the transition phases.
+ * - Linear speed at which to turn with the configured force.
+ */
+struct turn_profile {
+	int32_t transition;
+	int32_t arc_end;
+	int32_t length;
+	float inverse_transition;
+	enum turn_transition shape;
+	float linear_speed;
+};
+
+/**
+ * Path time estimation state.
+ *
+ * - Estimated time so far, in seconds.
+ * - Straight distance still to be run, in meters.
+ * - Speed at the start of that straight distance, in meters per second.
+ * - Nominal distance of the straight segments within it, in meters.
+ * - Index of the first of those straight segments, or -1 if none.
+ * - Last path segment and number of path segments so far.
+ */
+struct path_estimation {
+	float time;
+	float distance;
+	float speed;
+	float nominal;
+	int straight;
+	struct path_segment last;
+	int length;
+};
+
+static struct turn_profile profiles[TURNS_COUNT];
+static float profiles_force;
+
+/* Transition ramp, sin(x * PI / 2) sampled for x in [0, 1] */
+// clang-format off
+static const float turn_ramp[TURN_RAMP_STEPS + 1] = {
+    0.000000, 0.024541, 0.049068, 0.073565, 0.098017, 0.122411,
+    0.146730, 0.170962, 0.195090, 0.219101, 0.242980, 0.266713,
+    0.290285, 0.313682, 0.336890, 0.359895, 0.382683, 0.405241,
+    0.427555, 0.449611, 0.471397, 0.492898, 0.514103, 0.534998,
+    0.555570, 0.575808, 0.595699, 0.615232, 0.634393, 0.653173,
+    0.671559, 0.689541, 0.707107, 0.724247, 0.740951, 0.757209,
+    0.773010, 0.788346, 0.803208, 0.817585, 0.831470, 0.844854,
+    0.857729, 0.870087, 0.881921, 0.893224, 0.903989, 0.914210,
+    0.923880, 0.932993, 0.941544, 0.949528, 0.956940, 0.963776,
+    0.970031, 0.975702, 0.980785, 0.985278, 0.989177, 0.992480,
+    0.995185, 0.997290, 0.998795, 0.999699, 1.000000,
+};
+// clang-format on
+
+// clang-format off
+static const struct turn_design designs[TURNS_COUNT] = {
+    [MOVE_LEFT] = {false, 90, 0, 0.04921, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_90] = {false, 90, 0, 0.13000, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_180] = {false, 180, 1, 0., -0.04500, 0.06042, TURN_SINE},
+    [MOVE_LEFT_90_LONG] = {false, 90, 0, 0.15741, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_180_LONG] = {false, 180, 2, 0., -0.09000, 0.06042, TURN_SINE},
+    [MOVE_LEFT_TO_45] = {false, 45, 0, 0.10000, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_TO_135] = {false, 135, 0, 0.08000, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_FROM_45] = {true, 45, 0, 0.10000, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_FROM_135] = {true, 135, 0, 0.08000, 0., 0.06042, TURN_SINE},
+    [MOVE_LEFT_DIAGONAL] = {true, 90, 0, 0.06500, 0., 0.06042, TURN_SINE},
+};
+// clang-format on
+
+static struct turn_parameters turns[TURNS_COUNT];
+static bool turns_designed;
+
+/**
+ * Learned turn corrections, for each force range and turn type.
+ *
+ * - Marker of valid corrections, when persisted.
+ * - Correction of the straight distance before turning, in meters.
+ * - Correction of the straight distance after turning, in meters.
+ */
+static struct turn_learning {
+	uint32_t magic;
+	float before[LEARNING_FORCE_BINS][TURNS_COUNT];
+	float after[LEARNING_FORCE_BINS][TURNS_COUNT];
+} learning;
+static bool learning_enabled;
+
+/**
+ * @brief Get the transition ramp of a turn at some point.
+ *
+ * @param[in] shape Shape of the transition.
+ * @param[in] factor Transition completion, from 0 to 1.
+ *
+ * @return The fraction of the maximum curvature, from 0 to 1.
+ */
+static float _transition_ramp(enum turn_transition shape, float factor)
+{
+	if (shape == TURN_CLOTHOID)
+		return fminf(fmaxf(factor, 0.), 1.);
+	return get_turn_ramp(factor);
+}
+
+/**
+ * @brief Integrate the curve of a turn.
+ *
+ * The constant curvature arc is set so that the curve turns the given angle,
+ * shortening the transitions if they would turn more than that on their own.
+ *
+ * @param[in,out] turn Turn, with its radius, transition and shape set.
+ * @param[in] angle Angle to turn, in radians.
+ * @param[out] x Displacement along the entry direction, in meters.
+ * @param[out] y Displacement to the left of the entry direction, in meters.
+ */
+static void _integrate_turn(struct turn_parameters *turn, float angle,
+			    float *x, float *y)
+{
+	int i;
+	float ramp_average = (turn->shape == TURN_CLOTHOID) ? 0.5 : 2 / PI;
+	float length;
+	float step;
+	float travelled;
+	float factor;
+	float curvature;
+	float theta = 0.;
+
+	turn->arc = turn->radius * angle - 2 * turn->transition * ramp_average;
+	if (turn->arc < 0.) {
+		turn->transition = turn->radius * angle / (2 * ramp_average);
+		turn->arc = 0.;
+	}
+	length = 2 * turn->transition + turn->arc;
+	step = length / TURN_DESIGN_STEPS;
+	*x = 0.;
+	*y = 0.;
+	for (i = 0; i < TURN_DESIGN_STEPS; i++) {
+		travelled = (i + 0.5) * step;
+		factor = 1.;
+		if (travelled < turn->transition)
+			factor = travelled / turn->transition;
+		else if (travelled >= turn->transition + turn->arc)
+			factor = (length - travelled) / turn->transition;
+		if (turn->shape == TURN_CLOTHOID)
+			curvature = factor / turn->radius;
+		else
+			curvature = sin(factor * PI / 2) / turn->radius;
+		theta += curvature * step / 2;
+		*x += cos(theta) * step;
+		*y += sin(theta) * step;
+		theta += curvature * step / 2;
+	}
+}
+
+/**
+ * @brief Derive the parameters of a left turn from its design.
+ *
+ * The turn starts at the edge where the previous straight line ends and it
+ * finishes at the edge where the next one starts, which depends on the turn
+ * angle and on whether it starts on a diagonal:
+ *
+ * - Orthogonal 45 and 90 degree turns end at the left edge of the cell.
+ * - Orthogonal 135 degree turns end at the far edge of the left cell.
+ * - Diagonal 90 degree turns end one diagonal step ahead, one to the left.
+ * - 180 degree turns end back on the corridor `span` cells to the left. Their
+ *   radius is derived to get there and the straight distance is given.
+ * - Diagonal 45 and 135 degree turns are the reverse of the orthogonal ones.
+ *
+ * @param[in] design Turn design.
+ * @param[out] turn Turn parameters.
+ */
+static void _design_turn(const struct turn_design *design,
+			 struct turn_parameters *turn)
+{
+	int i;
+	float angle = design->degrees * PI / 180;
+	float target_x = CELL_DIMENSION / 2;
+	float target_y = CELL_DIMENSION / 2;
+	float lower;
+	float upper;
+	float swap;
+	float x;
+	float y;
+
+	turn->transition = design->transition;
+	turn->shape = design->shape;
+	turn->radius = design->radius;
+	turn->angle = angle;
+	if (design->degrees == 180) {
+		target_y = design->span * CELL_DIMENSION;
+		lower = 0.;
+		upper = target_y;
+		for (i = 0; i < TURN_DESIGN_ITERATIONS; i++) {
+			turn->radius = (lower + upper) / 2;
+			turn->transition = design->transition;
+			_integrate_turn(turn, angle, &x, &y);
+			if (y < target_y)
+				lower = turn->radius;
+			else
+				upper = turn->radius;
+		}
+		turn->before = design->straight;
+		turn->after = design->straight;
+		return;
+	}
+
+	if (design->diagonal && design->degrees == 90) {
+		target_x = CELL_DIAGONAL;
+		target_y = CELL_DIAGONAL;
+	} else if (design->degrees == 135) {
+		target_x = 0.;
+		target_y = CELL_DIMENSION;
+	}
+	_integrate_turn(turn, angle, &x, &y);
+	turn->after = (target_y - y) / sin(angle);
+	turn->before = target_x - x - turn->after * cos(angle);
+	if (design->diagonal && design->degrees != 90) {
+		swap = turn->before;
+		turn->before = turn->after;
+		turn->after = swap;
+	}
+}
+
+/**
+ * @brief Derive the parameters of every turn from the turn designs.
+ *
+ * Left turns are followed by their right counterpart in `enum movement`.
+ */
+static void _design_turns(void)
+{
+	int i;
+
+	for (i = MOVE_LEFT; i < TURNS_COUNT; i++) {
+		if (designs[i].degrees == 0)
+			continue;
+		_design_turn(&designs[i], &turns[i]);
+		turns[i].sign = -1;
+		turns[i + 1] = turns[i];
+		turns[i + 1].sign = 1;
+	}
+	turns_designed = true;
+}
+
+/**
+ * @brief Get the parameters of a turn, designing the turns if required.
+ *
+ * @param[in] turn_type Turn type.
+ */
+static struct turn_parameters *_get_turn(enum movement turn_type)
+{
+	if (!turns_designed)
+		_design_turns();
+	return &turns[turn_type];
+}
+
 /**
  * @brief Calculate the maximum search linear speed.
  *
@@ -50,12 +361,49 @@ static float _calculate_search_linear_speed(float force)
 		    2 * get_linear_deceleration() * break_margin);
 }
 
+/**
+ * @brief Build the turn profiles for a given force.
+ *
+ * Keeps square roots and divisions out of the turn loops, which only need to
+ * compare and scale the travelled micrometers.
+ *
+ * @param[in] force Maximum force to apply while turning.
+ */
+static void _build_turn_profiles(float force)
+{
+	int i;
+	struct turn_parameters *turn;
+	struct turn_profile *profile;
+
+	for (i = MOVE_LEFT; i < TURNS_COUNT; i++) {
+		turn = _get_turn(i);
+		if (turn->radius == 0.)
+			continue;
+		profile = &profiles[i];
+		profile->transition =
+		    (int32_t)(turn->transition * MICROMETERS_PER_METER);
+		profile->arc_end = (int32_t)((turn->transition + turn->arc) *
+					     MICROMETERS_PER_METER);
+		profile->length =
+		    (int32_t)(get_move_turn_length(i) * MICROMETERS_PER_METER);
+		profile->inverse_transition = 1. / profile->transition;
+		profile->shape = turn->shape;
+		profile->linear_speed = sqrt(get_movement_force(i, force) * 2 *
+					     turn->radius / MOUSE_MASS);
+	}
+	profiles_force = force;
+}
+
 /**
  * @brief Configure force and search/run mode.
  *
  * - Higher force results in higher accelerations.
+ * - Turns are designed, if not yet, and their profiles are built for the
+ *   given force or for their force override.
  * - Search mode limits the maximum linear speed for a smoother and more stable
  *   search.
+ * - Path translation automata are built, if not yet, so that no translation
+ *   table is built while moving.
  *
  * @param[in] force Maximum force to apply on the tires.
  * @param[in] run Whether to set speed variables for the run phase or not.
@@ -63,33 +411,15 @@ static float _calculate_search_linear_speed(float force)
 void kinematic_configuration(float force, bool run)
 {
 	max_force = force;
+	_build_turn_profiles(force);
+	if (!build_path_automata())
+		LOG_ERROR("Path automaton states overflow!");
 	if (run)
 		max_linear_speed = get_linear_speed_limit();
 	else
 		max_linear_speed = _calculate_search_linear_speed(force);
 }
 
-// clang-format off
-struct turn_parameters turns[] = {
-    [MOVE_LEFT] = {0.01700, 0.01700, 0.04921, 0.06042, 0.00037, -1},
-    [MOVE_RIGHT] = {0.01700, 0.01700, 0.04921, 0.06042, 0.00037, 1},
-    [MOVE_LEFT_90] = {-0.06272, -0.06272, 0.13000, 0.06042, 0.12728, -1},
-    [MOVE_RIGHT_90] = {-0.06272, -0.06272, 0.13000, 0.06042, 0.12728, 1},
-    [MOVE_LEFT_180] = {-0.04500, -0.04500, 0.08882, 0.06042, 0.20211, -1},
-    [MOVE_RIGHT_180] = {-0.04500, -0.04500, 0.08882, 0.06042, 0.20211, 1},
-    [MOVE_LEFT_TO_45] = {-0.06374, 0.06354, 0.10000, 0.06042, 0.00161, -1},
-    [MOVE_RIGHT_TO_45] = {-0.06374, 0.06354, 0.10000, 0.06042, 0.00161, 1},
-    [MOVE_LEFT_FROM_45] = {0.06354, -0.06374, 0.10000, 0.06042, 0.00161, -1},
-    [MOVE_RIGHT_FROM_45] = {0.06354, -0.06374, 0.10000, 0.06042, 0.00161, 1},
-    [MOVE_LEFT_TO_135] = {-0.03813, 0.03642, 0.08000, 0.06042, 0.11157, -1},
-    [MOVE_RIGHT_TO_135] = {-0.03813, 0.03642, 0.08000, 0.06042, 0.11157, 1},
-    [MOVE_LEFT_FROM_135] = {0.03642, -0.03813, 0.08000, 0.06042, 0.11157, -1},
-    [MOVE_RIGHT_FROM_135] = {0.03642, -0.03813, 0.08000, 0.06042, 0.11157, 1},
-    [MOVE_LEFT_DIAGONAL] = {0.03888, 0.03888, 0.06500, 0.06042, 0.02518, -1},
-    [MOVE_RIGHT_DIAGONAL] = {0.03888, 0.03888, 0.06500, 0.06042, 0.02518, 1},
-};
-// clang-format on
-
 float get_max_force(void)
 {
 	return max_force;
@@ -100,14 +430,113 @@ void set_max_force(float value)
 	max_force = value;
 }
 
+/**
+ * @brief Set the straight line force ratios.
+ *
+ * Straight lines accelerate and brake with the maximum force scaled by these
+ * ratios. Tires usually hold more force when braking than when accelerating
+ * from low speeds, and straight lines more than turns.
+ *
+ * @param[in] acceleration Ratio of the maximum force to accelerate with.
+ * @param[in] braking Ratio of the maximum force to brake with.
+ */
+void set_linear_force_ratios(float acceleration, float braking)
+{
+	acceleration_force_ratio = acceleration;
+	braking_force_ratio = braking;
+}
+
+/**
+ * @brief Get the straight line acceleration for a given force.
+ *
+ * @param[in] force Maximum force to apply on the tires.
+ *
+ * @return The acceleration, in meters per second squared.
+ */
+static float _linear_acceleration(float force)
+{
+	return 2 * force * acceleration_force_ratio / MOUSE_MASS;
+}
+
+/**
+ * @brief Get the straight line deceleration for a given force.
+ *
+ * @param[in] force Maximum force to apply on the tires.
+ *
+ * @return The deceleration, in meters per second squared.
+ */
+static float _linear_deceleration(float force)
+{
+	return 2 * force * braking_force_ratio / MOUSE_MASS;
+}
+
 float get_linear_acceleration(void)
 {
-	return 2 * max_force / MOUSE_MASS;
+	return _linear_acceleration(max_force);
 }
 
 float get_linear_deceleration(void)
 {
-	return 2 * max_force / MOUSE_MASS;
+	return _linear_deceleration(max_force);
+}
+
+/**
+ * @brief Override the force to apply on a given speed turn.
+ *
+ * Turns with a lower risk of slipping can be executed with a higher force,
+ * and so at a higher speed, while the rest keep the force of the run.
+ *
+ * Only speed turns can be overridden. Straight lines always accelerate and
+ * brake with the force of the run, so any other movement is rejected with a
+ * warning.
+ *
+ * @param[in] movement Speed turn to override.
+ * @param[in] force Force to apply on the turn, or zero to remove the
+ * override.
+ */
+void set_movement_force(enum movement movement, float force)
+{
+	if (movement < MOVE_LEFT || movement >= TURNS_COUNT ||
+	    _get_turn(movement)->radius == 0.) {
+		LOG_WARNING("Force override ignored for movement %d!",
+			    movement);
+		return;
+	}
+	movement_forces[movement] = force;
+	if (profiles_force > 0.)
+		_build_turn_profiles(profiles_force);
+}
+
+/**
+ * @brief Get the force to apply on a given movement.
+ *
+ * @param[in] movement Movement to execute.
+ * @param[in] force Force to apply if the movement is not overridden.
+ *
+ * @return The force to apply on the movement.
+ */
+float get_movement_force(enum movement movement, float force)
+{
+	if (movement_forces[movement] > 0.)
+		return movement_forces[movement];
+	return force;
+}
+
+float get_linear_jerk(void)
+{
+	return max_linear_jerk;
+}
+
+/**
+ * @brief Set the maximum linear jerk, in meters per second cubed.
+ *
+ * A positive value enables jerk-limited (S-curve) speed profiles, which avoid
+ * sudden acceleration changes at the cost of slightly longer speed changes.
+ * Zero goes back to trapezoidal speed profiles.
+ */
+void set_linear_jerk(float value)
+{
+	max_linear_jerk = value;
 }
 
 float get_max_linear_speed(void)
@@ -120,6 +549,87 @@ void set_max_linear_speed(float value)
 	max_linear_speed = value;
 }
 
+/**
+ * @brief Get the transition ramp at some point.
+ *
+ * Interpolates the precomputed ramp table, which is cheaper than calling
+ * `sin()` on every control tick.
+ *
+ * @param[in] factor Transition completion, from 0 to 1.
+ *
+ * @return The ramp value, sin(factor * PI / 2).
+ */
+float get_turn_ramp(float factor)
+{
+	int index;
+	float position;
+
+	if (factor <= 0.)
+		return 0.;
+	if (factor >= 1.)
+		return 1.;
+	position = factor * TURN_RAMP_STEPS;
+	index = (int)position;
+	return turn_ramp[index] +
+	       (position - index) * (turn_ramp[index + 1] - turn_ramp[index]);
+}
+
+/**
+ * @brief Get the curvature of a turn at some point.
+ *
+ * The curvature grows following a sine, or linearly for clothoids, during the
+ * transition phases and stays constant along the arc.
+ *
+ * @param[in] turn_type Turn type.
+ * @param[in] travelled Distance travelled since the start of the turn, in
+ * meters.
+ *
+ * @return The signed curvature, in radians per meter (negative means left).
+ */
+float get_move_turn_curvature(enum movement turn_type, float travelled)
+{
+	float factor;
+	struct turn_parameters *turn = _get_turn(turn_type);
+
+	if (travelled < turn->transition) {
+		factor = travelled / turn->transition;
+		return turn->sign * _transition_ramp(turn->shape, factor) /
+		       turn->radius;
+	}
+	if (travelled >= turn->transition + turn->arc) {
+		factor = (travelled - turn->arc) / turn->transition;
+		return turn->sign * _transition_ramp(turn->shape, 2 - factor) /
+		       turn->radius;
+	}
+	return turn->sign / turn->radius;
+}
+
+/**
+ * @brief Get the fraction of the maximum curvature of a turn at some point.
+ *
+ * Uses the turn profiles built by `kinematic_configuration()`.
+ *
+ * @param[in] turn_type Turn type.
+ * @param[in] travelled Distance travelled since the start of the turn, in
+ * micrometers.
+ *
+ * @return The curvature fraction, from 0 to 1.
+ */
+float get_move_turn_ramp(enum movement turn_type, int32_t travelled)
+{
+	struct turn_profile *profile = &profiles[turn_type];
+	float factor;
+
+	if (travelled < profile->arc_end && travelled >= profile->transition)
+		return 1.;
+	if (travelled < profile->transition)
+		factor = travelled * profile->inverse_transition;
+	else
+		factor = (profile->length - travelled) *
+			 profile->inverse_transition;
+	return _transition_ramp(profile->shape, factor);
+}
+
 /**
  * @brief Execute a speed turn.
  *
@@ -128,65 +638,185 @@ void set_max_linear_speed(float value)
  */
 void speed_turn(enum movement turn_type, float force)
 {
-	int32_t start;
-	int32_t current;
-	float travelled;
-	float linear_velocity;
-	float angular_velocity;
-	float max_angular_velocity;
-	float factor;
-	struct turn_parameters turn = turns[turn_type];
+	if (!push_motion_turn(turn_type,
+			      get_move_turn_linear_speed(turn_type, force)))
+		return;
+	wait_motion_idle();
+}
 
-	linear_velocity = get_move_turn_linear_speed(turn_type, force);
-	max_angular_velocity = turn.sign * linear_velocity / turn.radius;
+/**
+ * @brief Get the learned corrections force range of a turn.
+ *
+ * It is the range of the force the turn is executed with, as configured.
+ *
+ * @param[in] turn_type Turn type.
+ */
+static int _learning_bin(enum movement turn_type)
+{
+	int bin;
 
-	disable_walls_control();
-	start = get_encoder_average_micrometers();
-	while (true) {
-		current = get_encoder_average_micrometers();
-		travelled = (float)(current - start) / MICROMETERS_PER_METER;
-		if (travelled >= 2 * turn.transition + turn.arc)
-			break;
-		angular_velocity = max_angular_velocity;
-		if (travelled < turn.transition) {
-			factor = travelled / turn.transition;
-			angular_velocity *= sin(factor * PI / 2);
-		} else if (travelled >= turn.transition + turn.arc) {
-			factor = (travelled - turn.arc) / turn.transition;
-			angular_velocity *= sin(factor * PI / 2);
-		}
-		set_ideal_angular_speed(angular_velocity);
-	}
-	set_ideal_angular_speed(0);
+	bin = (int)(get_movement_force(turn_type, profiles_force) /
+		    LEARNING_FORCE_STEP);
+	if (bin >= LEARNING_FORCE_BINS)
+		bin = LEARNING_FORCE_BINS - 1;
+	return bin;
+}
+
+/**
+ * @brief Limit a learned turn correction.
+ */
+static float _limit_correction(float correction)
+{
+	if (correction > LEARNING_MAX_CORRECTION)
+		return LEARNING_MAX_CORRECTION;
+	if (correction < -LEARNING_MAX_CORRECTION)
+		return -LEARNING_MAX_CORRECTION;
+	return correction;
 }
 
 /**
  * @brief Get the straight distance that a turn adds before a straight movement.
  *
+ * Includes the learned correction for the configured force.
+ *
  * @param[in] turn_type Turn type.
  *
  * @return The added distance.
  */
 float get_move_turn_before(enum movement turn_type)
 {
-	return turns[turn_type].before;
+	return _get_turn(turn_type)->before +
+	       learning.before[_learning_bin(turn_type)][turn_type];
 }
 
 /**
  * @brief Get the straight distance that a turn adds after a straight movement.
  *
+ * Includes the learned correction for the configured force.
+ *
  * @param[in] turn_type Turn type.
  *
  * @return The added distance.
  */
 float get_move_turn_after(enum movement turn_type)
 {
-	return turns[turn_type].after;
+	return _get_turn(turn_type)->after +
+	       learning.after[_learning_bin(turn_type)][turn_type];
+}
+
+/**
+ * @brief Enable or disable learning turn corrections from turn exits.
+ *
+ * Learned corrections are applied in any case.
+ */
+void enable_turn_learning(bool value)
+{
+	learning_enabled = value;
+}
+
+/**
+ * @brief Learn from the lateral offset measured at the exit of a turn.
+ *
+ * Turning earlier or later moves the exit aside, so the straight distance
+ * before turning is corrected. It is an integral correction, as the offset is
+ * measured with the current correction already applied. 180 degree turns are
+ * not corrected, as their exit does not move aside.
+ *
+ * @param[in] turn_type Turn type, which must exit on an orthogonal.
+ * @param[in] offset Lateral offset from the corridor centre line, in meters,
+ * positive to the left.
+ */
+void learn_move_turn_lateral(enum movement turn_type, float offset)
+{
+	struct turn_parameters *turn = _get_turn(turn_type);
+	float aside = sin(-turn->sign * turn->angle);
+	float *before;
+
+	if (!learning_enabled || fabsf(aside) < 0.5)
+		return;
+	before = &learning.before[_learning_bin(turn_type)][turn_type];
+	*before = _limit_correction(*before + LEARNING_RATE * offset / aside);
+}
+
+/**
+ * @brief Learn from the front wall distance measured at the exit of a turn.
+ *
+ * The longitudinal exit error does not depend on the straight distance after
+ * turning, so its correction converges to the average error. The expected
+ * distance assumes the front wall closes the cell that is about to be
+ * entered, or any of the following ones.
+ *
+ * @param[in] turn_type Turn type, which must exit on an orthogonal.
+ * @param[in] distance Front wall distance, in meters.
+ */
+void learn_move_turn_front_wall(enum movement turn_type, float distance)
+{
+	struct turn_parameters *turn = _get_turn(turn_type);
+	float error;
+	float *after;
+
+	if (!learning_enabled)
+		return;
+	error = CELL_DIMENSION + turn->after - distance;
+	error -= CELL_DIMENSION * floorf(error / CELL_DIMENSION + 0.5);
+	after = &learning.after[_learning_bin(turn_type)][turn_type];
+	*after = _limit_correction(*after + LEARNING_RATE * (-error - *after));
+}
+
+/**
+ * @brief Save the learned turn corrections on EEPROM.
+ *
+ * Requires `FLASH_EEPROM_ADDRESS_TURNS` to be defined by the platform,
+ * otherwise corrections cannot be persisted and an error is logged.
+ */
+void save_turn_learning(void)
+{
+#ifdef FLASH_EEPROM_ADDRESS_TURNS
+	uint32_t save_status;
+
+	learning.magic = LEARNING_MAGIC;
+	save_status = eeprom_flash_page(FLASH_EEPROM_ADDRESS_TURNS,
+					(uint8_t *)&learning, sizeof(learning));
+	if (save_status != RESULT_OK)
+		LOG_ERROR("EEPROM save error %" PRIu32, save_status);
+#else
+	LOG_ERROR("No EEPROM address to save turn learning!");
+#endif
+}
+
+/**
+ * @brief Load the learned turn corrections from EEPROM.
+ *
+ * Corrections are reset if none were saved, or if `FLASH_EEPROM_ADDRESS_TURNS`
+ * is not defined by the platform.
+ */
+void load_turn_learning(void)
+{
+#ifdef FLASH_EEPROM_ADDRESS_TURNS
+	eeprom_read_data(FLASH_EEPROM_ADDRESS_TURNS, sizeof(learning),
+			 (uint8_t *)&learning);
+	if (learning.magic != LEARNING_MAGIC)
+		reset_turn_learning();
+#else
+	reset_turn_learning();
+#endif
+}
+
+/**
+ * @brief Forget the learned turn corrections.
+ */
+void reset_turn_learning(void)
+{
+	memset(&learning, 0, sizeof(learning));
 }
 
 /**
  * @brief Get the expected linear speed at which to turn.
  *
+ * The force override of the turn, if any, takes precedence over the given
+ * force. The precomputed profile speed is used if the force is the configured
+ * one.
+ *
  * @param[in] turn_type Turn type.
  * @param[in] force Maximum force to apply while turning.
  *
@@ -194,5 +824,456 @@ float get_move_turn_after(enum movement turn_type)
  */
 float get_move_turn_linear_speed(enum movement turn_type, float force)
 {
-	return sqrt(force * 2 * turns[turn_type].radius / MOUSE_MASS);
+	float radius;
+
+	if (force == profiles_force)
+		return profiles[turn_type].linear_speed;
+	radius = _get_turn(turn_type)->radius;
+	return sqrt(get_movement_force(turn_type, force) * 2 * radius /
+		    MOUSE_MASS);
+}
+
+/**
+ * @brief Get the distance travelled while turning.
+ *
+ * @param[in] turn_type Turn type.
+ *
+ * @return The turn distance, in meters.
+ */
+float get_move_turn_length(enum movement turn_type)
+{
+	struct turn_parameters *turn = _get_turn(turn_type);
+
+	return 2 * turn->transition + turn->arc;
+}
+
+/**
+ * @brief Get the time a speed change takes, in seconds.
+ *
+ * If a maximum linear jerk is defined, the profile is jerk-limited, starting
+ * and ending with zero acceleration, like the one the motor control follows.
+ *
+ * @param[in] speed_change Absolute speed change, in meters per second.
+ * @param[in] acceleration Maximum absolute acceleration.
+ */
+static float _speed_change_time(float speed_change, float acceleration)
+{
+	float jerk = max_linear_jerk;
+
+	if (jerk <= 0.)
+		return speed_change / acceleration;
+	if (speed_change * jerk >= acceleration * acceleration)
+		return speed_change / acceleration + acceleration / jerk;
+	return 2 * sqrt(speed_change / jerk);
+}
+
+/**
+ * @brief Get the distance a speed change takes, in meters.
+ *
+ * The profile is symmetric, so the distance is travelled at the mean speed.
+ *
+ * @param[in] start_speed Speed at the start of the change.
+ * @param[in] end_speed Speed at the end of the change.
+ * @param[in] acceleration Maximum absolute acceleration.
+ */
+static float _speed_change_distance(float start_speed, float end_speed,
+				    float acceleration)
+{
+	return (start_speed + end_speed) / 2 *
+	       _speed_change_time(fabsf(end_speed - start_speed), acceleration);
+}
+
+/**
+ * @brief Get the peak speed of a straight line.
+ *
+ * It is the speed at which the acceleration and braking phases meet, without
+ * considering the linear speed limit.
+ *
+ * With a maximum linear jerk defined, the peak speed is searched by bisection
+ * below the trapezoidal one, which is always an upper bound. If the speed
+ * change between the start and the end does not fit in the distance, the
+ * highest of both is returned.
+ *
+ * @param[in] distance Distance to travel, in meters.
+ * @param[in] start_speed Speed at the start of the straight line.
+ * @param[in] end_speed Speed at the end of the straight line.
+ * @param[in] acceleration Acceleration to apply.
+ * @param[in] deceleration Deceleration to apply.
+ *
+ * @return The peak speed, in meters per second.
+ */
+static float _peak_speed(float distance, float start_speed, float end_speed,
+			 float acceleration, float deceleration)
+{
+	int i;
+	float low;
+	float high;
+	float middle;
+
+	high = sqrt((2 * acceleration * deceleration * distance +
+		     deceleration * start_speed * start_speed +
+		     acceleration * end_speed * end_speed) /
+		    (acceleration + deceleration));
+	low = fmaxf(start_speed, end_speed);
+	if (max_linear_jerk <= 0. || high <= low)
+		return high;
+	for (i = 0; i < SPEED_SEARCH_ITERATIONS; i++) {
+		middle = (low + high) / 2;
+		if (_speed_change_distance(start_speed, middle, acceleration) +
+			_speed_change_distance(middle, end_speed,
+					       deceleration) >
+		    distance)
+			high = middle;
+		else
+			low = middle;
+	}
+	return low;
+}
+
+/**
+ * @brief Get the expected time to travel a straight line.
+ *
+ * Assumes a trapezoidal speed profile limited by the linear speed limit, with
+ * the acceleration and deceleration that correspond to the given force. The
+ * acceleration and braking phases are jerk-limited if a maximum linear jerk is
+ * defined.
+ *
+ * @param[in] distance Distance to travel, in meters.
+ * @param[in] start_speed Speed at the start of the straight line.
+ * @param[in] end_speed Speed at the end of the straight line.
+ * @param[in] force Maximum force to apply on the tires.
+ *
+ * @return The expected time, in seconds.
+ */
+float get_straight_time(float distance, float start_speed, float end_speed,
+			float force)
+{
+	float acceleration = _linear_acceleration(force);
+	float deceleration = _linear_deceleration(force);
+	float max_speed = get_linear_speed_limit();
+	float peak_speed;
+	float cruise_distance;
+
+	if (distance <= 0.)
+		return 0.;
+	peak_speed = _peak_speed(distance, start_speed, end_speed,
+				 acceleration, deceleration);
+	if (peak_speed < start_speed || peak_speed < end_speed)
+		return 2 * distance / (start_speed + end_speed);
+	if (peak_speed > max_speed)
+		peak_speed = max_speed;
+	cruise_distance =
+	    distance -
+	    _speed_change_distance(start_speed, peak_speed, acceleration) -
+	    _speed_change_distance(peak_speed, end_speed, deceleration);
+	if (cruise_distance < 0.)
+		cruise_distance = 0.;
+	return _speed_change_time(peak_speed - start_speed, acceleration) +
+	       _speed_change_time(peak_speed - end_speed, deceleration) +
+	       cruise_distance / peak_speed;
+}
+
+/**
+ * @brief Close the straight line of a path time estimation.
+ *
+ * The straight line time is shared among the straight segments it is made of,
+ * in proportion to their nominal distance, or given to the movement that
+ * closes it if there are none.
+ *
+ * @param[in,out] estimation Path time estimation state.
+ * @param[in] index Index of the movement that closes the straight line, or
+ * the path length if the path ends with the straight line.
+ * @param[in] end_speed Speed at the end of the straight line.
+ * @param[in] force Maximum force to apply on the tires.
+ * @param[out] times Time of each path segment, or `NULL`.
+ */
+static void close_straight(struct path_estimation *estimation, int index,
+			   float end_speed, float force, float *times)
+{
+	int i;
+	float time;
+
+	time = get_straight_time(estimation->distance, estimation->speed,
+				 end_speed, force);
+	estimation->time += time;
+	if (times && estimation->straight < 0)
+		times[index] += time;
+	else if (times)
+		for (i = estimation->straight; i < index; i++)
+			times[i] = time * times[i] / estimation->nominal;
+	estimation->speed = end_speed;
+	estimation->nominal = 0.;
+	estimation->straight = -1;
+}
+
+/**
+ * @brief Add a smooth movement to a path time estimation.
+ *
+ * Straight lines are accumulated just like when executing the path.
+ *
+ * @param[in,out] estimation Path time estimation state.
+ * @param[in] movement Smooth movement to add.
+ * @param[in] force Maximum force to apply on the tires.
+ * @param[out] times Time of each path segment, or `NULL`.
+ */
+static void estimate_movement(struct path_estimation *estimation,
+			      enum movement movement, float force,
+			      float *times)
+{
+	int index;
+	float nominal;
+	float turn_speed;
+	float turn_time;
+
+	if (estimation->length &&
+	    path_segment_merges(&estimation->last, movement)) {
+		estimation->last.count++;
+	} else {
+		estimation->last.movement = movement;
+		estimation->last.count = 1;
+		if (times)
+			times[estimation->length] = 0.;
+		estimation->length++;
+	}
+	index = estimation->length - 1;
+
+	switch (movement) {
+	case MOVE_START:
+		estimation->distance = -MOUSE_START_SHIFT;
+		return;
+	case MOVE_FRONT:
+		nominal = CELL_DIMENSION;
+		break;
+	case MOVE_DIAGONAL:
+		nominal = CELL_DIAGONAL;
+		break;
+	case MOVE_STOP:
+		estimation->distance -= CELL_DIMENSION / 2;
+		close_straight(estimation, index, 0., force, times);
+		estimation->distance = 0.;
+		return;
+	default:
+		estimation->distance += get_move_turn_before(movement);
+		turn_speed = get_move_turn_linear_speed(movement, force);
+		close_straight(estimation, index, turn_speed, force, times);
+		turn_time = get_move_turn_length(movement) / turn_speed;
+		estimation->time += turn_time;
+		if (times)
+			times[index] += turn_time;
+		estimation->distance = get_move_turn_after(movement);
+		return;
+	}
+	estimation->distance += nominal;
+	estimation->nominal += nominal;
+	if (estimation->straight < 0)
+		estimation->straight = index;
+	if (times)
+		times[index] += nominal;
+}
+
+/**
+ * @brief Estimate the time it takes to execute a raw path.
+ *
+ * The path is smoothed on the fly and the estimation integrates trapezoidal
+ * straight line profiles and speed turns, as they would be executed with the
+ * given force.
+ *
+ * @param[in] path Raw path to estimate.
+ * @param[in] language Language to use for the raw-to-smooth path translation.
+ * @param[in] force Maximum force to apply on the tires.
+ * @param[out] times Array to write the time of each smooth path segment to,
+ * in the same order as `make_smooth_segments()` produces them, or `NULL`.
+ *
+ * @return The estimated time, in seconds.
+ */
+float estimate_path_time(char *path, enum path_language language, float force,
+			 float *times)
+{
+	int i;
+	int count;
+	struct path_estimation estimation = {0};
+	struct path_translator translator;
+	enum movement emitted[PATH_LOOKAHEAD];
+
+	estimation.straight = -1;
+	reset_path_translator(&translator, language);
+	do {
+		count = translate_raw_step(&translator, *path, emitted);
+		for (i = 0; i < count; i++)
+			estimate_movement(&estimation, emitted[i], force,
+					  times);
+	} while (*path++ != '\0');
+	if (estimation.straight >= 0)
+		close_straight(&estimation, estimation.length, 0., force,
+			       times);
+	return estimation.time;
+}
+
+/**
+ * @brief Get the maximum speed reachable after a straight line.
+ *
+ * With a maximum linear jerk defined, the reachable speed is searched by
+ * bisection below the one reachable with constant acceleration.
+ *
+ * @param[in] speed Speed at the start of the straight line.
+ * @param[in] distance Straight line distance, in meters.
+ * @param[in] acceleration Acceleration, or deceleration, to apply.
+ *
+ * @return The reachable speed, in meters per second.
+ */
+static float _reachable_speed(float speed, float distance, float acceleration)
+{
+	int i;
+	float low = speed;
+	float high;
+	float middle;
+
+	if (distance <= 0.)
+		return speed;
+	high = sqrt(speed * speed + 2 * acceleration * distance);
+	if (max_linear_jerk <= 0.)
+		return high;
+	for (i = 0; i < SPEED_SEARCH_ITERATIONS; i++) {
+		middle = (low + high) / 2;
+		if (_speed_change_distance(speed, middle, acceleration) >
+		    distance)
+			high = middle;
+		else
+			low = middle;
+	}
+	return low;
+}
+
+/**
+ * @brief Set the planned peak speed of the straight segments of a line.
+ *
+ * @param[in] path Smooth path segments.
+ * @param[in] first Index of the first segment of the straight line.
+ * @param[in] last Index of the segment that closes the straight line.
+ * @param[in] distance Straight line distance, in meters.
+ * @param[in] start_speed Speed at the start of the straight line.
+ * @param[in] end_speed Speed at the end of the straight line.
+ * @param[in] acceleration Acceleration to apply.
+ * @param[in] deceleration Deceleration to apply.
+ * @param[out] speeds Planned speed for each segment.
+ */
+static void _plan_straight_peak(struct path_segment *path, int first, int last,
+				float distance, float start_speed,
+				float end_speed, float acceleration,
+				float deceleration, float *speeds)
+{
+	int i;
+	float peak = get_linear_speed_limit();
+
+	if (distance > 0.)
+		peak = fminf(peak, _peak_speed(distance, start_speed, end_speed,
+					       acceleration, deceleration));
+	for (i = first; i < last; i++)
+		if (path[i].movement == MOVE_FRONT ||
+		    path[i].movement == MOVE_DIAGONAL)
+			speeds[i] = peak;
+}
+
+/**
+ * @brief Plan the speed of each segment of a smooth path.
+ *
+ * Speed turns are meant to be executed at a constant speed, which must be
+ * reachable from the previous one within the straight line between them:
+ *
+ * - A backward pass limits each turn speed so that the mouse can still brake
+ *   for every turn and stop that follows, using the braking force.
+ * - A forward pass limits each turn speed so that the mouse can accelerate to
+ *   it from the start and from the previous turns, using the acceleration
+ *   force.
+ *
+ * Turns are planned with their force override, if any.
+ *
+ * @param[in] path Smooth path segments to plan.
+ * @param[in] force Maximum force to apply on the tires.
+ * @param[out] speeds Array to write the planned speed of each segment to. For
+ * turns, the speed at which to turn; for straight segments, the peak speed of
+ * the straight line they belong to; zero for the start and the stop.
+ */
+void plan_path_speeds(struct path_segment *path, float force, float *speeds)
+{
+	int i;
+	int length;
+	int straight = 0;
+	enum movement movement;
+	float acceleration = _linear_acceleration(force);
+	float deceleration = _linear_deceleration(force);
+	float distance = 0.;
+	float speed = 0.;
+	float reachable;
+
+	for (length = 0; path[length].movement != MOVE_END; length++)
+		;
+
+	for (i = length - 1; i >= 0; i--) {
+		movement = path[i].movement;
+		speeds[i] = 0.;
+		switch (movement) {
+		case MOVE_START:
+			break;
+		case MOVE_STOP:
+			distance = -CELL_DIMENSION / 2;
+			speed = 0.;
+			break;
+		case MOVE_FRONT:
+			distance += path[i].count * CELL_DIMENSION;
+			break;
+		case MOVE_DIAGONAL:
+			distance += path[i].count * CELL_DIAGONAL;
+			break;
+		default:
+			distance += get_move_turn_after(movement);
+			reachable =
+			    _reachable_speed(speed, distance, deceleration);
+			speed = get_move_turn_linear_speed(movement, force);
+			if (speed > reachable)
+				speed = reachable;
+			speeds[i] = speed;
+			distance = get_move_turn_before(movement);
+			break;
+		}
+	}
+
+	for (i = 0; i < length; i++) {
+		movement = path[i].movement;
+		switch (movement) {
+		case MOVE_START:
+			distance = -MOUSE_START_SHIFT;
+			speed = 0.;
+			straight = i + 1;
+			break;
+		case MOVE_FRONT:
+			distance += path[i].count * CELL_DIMENSION;
+			break;
+		case MOVE_DIAGONAL:
+			distance += path[i].count * CELL_DIAGONAL;
+			break;
+		case MOVE_STOP:
+			distance -= CELL_DIMENSION / 2;
+			_plan_straight_peak(path, straight, i, distance, speed,
+					    0., acceleration, deceleration,
+					    speeds);
+			distance = 0.;
+			speed = 0.;
+			straight = i + 1;
+			break;
+		default:
+			distance += get_move_turn_before(movement);
+			reachable =
+			    _reachable_speed(speed, distance, acceleration);
+			if (speeds[i] > reachable)
+				speeds[i] = reachable;
+			_plan_straight_peak(path, straight, i, distance, speed,
+					    speeds[i], acceleration,
+					    deceleration, speeds);
+			distance = get_move_turn_after(movement);
+			speed = speeds[i];
+			straight = i + 1;
+			break;
+		}
+	}
 }
@@ -5,23 +5,52 @@
 
 #include "mmlib/common.h"
 #include "mmlib/control.h"
+#include "mmlib/logging.h"
+#include "mmlib/motion.h"
 #include "mmlib/move.h"
 #include "mmlib/path.h"
 
 #include "config.h"
+#include "eeprom.h"
 #include "setup.h"
 
+enum turn_transition {
+	TURN_SINE,     /**< Curvature follows a sine */
+	TURN_CLOTHOID, /**< Curvature grows linearly */
+};
+
 float get_max_force(void);
 void set_max_force(float value);
+void set_linear_force_ratios(float acceleration, float braking);
 float get_linear_acceleration(void);
 float get_linear_deceleration(void);
+void set_movement_force(enum movement movement, float force);
+float get_movement_force(enum movement movement, float force);
+float get_linear_jerk(void);
+void set_linear_jerk(float value);
 float get_max_linear_speed(void);
 void set_max_linear_speed(float value);
 void kinematic_configuration(float force, bool run);
 float get_move_turn_before(enum movement move);
 float get_move_turn_after(enum movement move);
 float get_move_turn_linear_speed(enum movement turn_type, float force);
+float get_move_turn_length(enum movement turn_type);
+float get_turn_ramp(float factor);
+float get_move_turn_curvature(enum movement turn_type, float travelled);
+float get_move_turn_ramp(enum movement turn_type, int32_t travelled);
+float get_straight_time(float distance, float start_speed, float end_speed,
+			float force);
+float estimate_path_time(char *path, enum path_language language, float force,
+			 float *times);
+void plan_path_speeds(struct path_segment *path, float force, float *speeds);
 
 void speed_turn(enum movement turn_type, float force);
 
+void enable_turn_learning(bool value);
+void learn_move_turn_lateral(enum movement turn_type, float offset);
+void learn_move_turn_front_wall(enum movement turn_type, float distance);
+void save_turn_learning(void);
+void load_turn_learning(void);
+void reset_turn_learning(void);
+
 #endif /* __SPEED_H */
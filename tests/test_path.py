@@ -28,7 +28,9 @@ def smooth_path(interface, sharp, language):
     return result[:result.index('END')]
 
 
-@pytest.mark.parametrize('language', ['PATH_SAFE', 'PATH_DIAGONALS'])
+@pytest.mark.parametrize('language', [
+    'PATH_SAFE', 'PATH_DIAGONALS', 'PATH_AGGRESSIVE',
+])
 @pytest.mark.parametrize('sharp', [
     '', 'F', 'FF', 'FLF', 'FRF', 'FLLF', 'FLRF', 'FRRF', 'FRLF', 'FRFLLF',
 ])
@@ -146,3 +148,105 @@ def test_path_smoother_diagonals(interface, sharp, smooth):
     Test correct path smoothing with the diagonals language.
     """
     assert smooth == smooth_path(interface, sharp, 'PATH_DIAGONALS')
+
+
+@pytest.mark.parametrize('sharp,smooth', [
+    ('FLF', ['FRONT', 'LEFT_90_LONG', 'FRONT']),
+    ('FRF', ['FRONT', 'RIGHT_90_LONG', 'FRONT']),
+    ('FLFLF', ['FRONT', 'LEFT_180_LONG', 'FRONT']),
+    ('FRFRF', ['FRONT', 'RIGHT_180_LONG', 'FRONT']),
+    ('FLFRF', ['FRONT', 'LEFT_90_LONG', 'FRONT', 'RIGHT_90_LONG', 'FRONT']),
+    ('FLFLLF', ['FRONT', 'LEFT_90_LONG', 'FRONT', 'LEFT_180', 'FRONT']),
+    ('FLLF', ['FRONT', 'LEFT_180', 'FRONT']),
+    ('FLRLF', ['FRONT', 'LEFT_TO_45', 'DIAGONAL', 'LEFT_FROM_45', 'FRONT']),
+], ids=[
+    'Long-radius 90-degrees left turn',
+    'Long-radius 90-degrees right turn',
+    'Long-radius 180-degrees left turn',
+    'Long-radius 180-degrees right turn',
+    'Long-radius 90-degrees left, then right',
+    'Long-radius 90-degrees left, then 180-degrees left',
+    'Keep 180-degrees turns within one cell',
+    'Keep diagonals',
+])
+def test_path_smoother_aggressive(interface, sharp, smooth):
+    """
+    Test correct path smoothing with the aggressive language.
+    """
+    assert smooth == smooth_path(interface, sharp, 'PATH_AGGRESSIVE')
+
+
+@pytest.mark.parametrize('sharp,segments', [
+    ('BFFFS', [('START', 1), ('FRONT', 3), ('STOP', 1)]),
+    ('FFLFF', [('FRONT', 2), ('LEFT_90', 1), ('FRONT', 2)]),
+    ('FLRLRLRF', [('FRONT', 1), ('LEFT_TO_45', 1), ('DIAGONAL', 4),
+                  ('RIGHT_FROM_45', 1), ('FRONT', 1)]),
+    ('FLLFFRRF', [('FRONT', 1), ('LEFT_180', 1), ('FRONT', 2),
+                  ('RIGHT_180', 1), ('FRONT', 1)]),
+    ('F' * 300, [('FRONT', 255), ('FRONT', 45)]),
+], ids=[
+    'Merge straights',
+    'Merge straights around a turn',
+    'Merge diagonals',
+    'Do not merge consecutive turns',
+    'Split straights exceeding the count',
+])
+def test_path_smoother_segments(interface, sharp, segments):
+    """
+    Test smoothing into segments, with merged straights and diagonals.
+    """
+    ffi, lib = interface
+    result = ffi.new('struct path_segment destination[30]')
+    lib.make_smooth_segments(sharp.encode('ascii'), result,
+                             lib.PATH_DIAGONALS)
+    movements = stringify_enums([x.movement for x in result], ffi,
+                                'enum movement')
+    result = [(x[5:], y.count) for x, y in zip(movements, result)]
+    assert segments + [('END', 1)] == result[:len(segments) + 1]
+
+
+def test_path_segment_size(interface):
+    """
+    Smooth path segments must be packed in two bytes.
+    """
+    ffi, lib = interface
+    assert ffi.sizeof('struct path_segment') == 2
+
+
+def test_path_automata_fit(interface):
+    """
+    Translation automata of all languages must fit in the state table.
+    """
+    ffi, lib = interface
+    assert lib.build_path_automata()
+
+
+@pytest.mark.parametrize('language,sharp,emitted', [
+    ('PATH_SEARCH', 'FLRF', [['FRONT'], ['LEFT'], ['RIGHT'], ['FRONT'], []]),
+    ('PATH_DIAGONALS', 'FLF',
+     [['FRONT'], [], ['LEFT_90', 'FRONT'], []]),
+    ('PATH_DIAGONALS', 'FLLR',
+     [['FRONT'], [], [], ['LEFT_TO_135'], []]),
+    ('PATH_DIAGONALS', 'FRLS',
+     [['FRONT'], [], ['RIGHT_TO_45'], ['STOP'], []]),
+], ids=[
+    'Search steps without lookahead',
+    'Wait for the turn to resolve',
+    'Wait for the longest translation',
+    'Drop unresolved raw characters at the end',
+])
+def test_path_translator_streaming(interface, language, sharp, emitted):
+    """
+    Test streaming translation, pushing one raw character at a time.
+    """
+    ffi, lib = interface
+    translator = ffi.new('struct path_translator *')
+    movements = ffi.new('enum movement emitted[4]')
+    lib.reset_path_translator(translator, getattr(lib, language))
+    result = []
+    for raw in sharp.encode('ascii') + b'\0':
+        count = lib.translate_raw_step(translator, bytes([raw]), movements)
+        result.append([x[5:] for x in
+                       stringify_enums(movements[0:count], ffi,
+                                       'enum movement')])
+    assert emitted == result
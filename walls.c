@@ -125,6 +125,35 @@ float get_front_sensors_error(void)
 	return distance[SENSOR_FRONT_LEFT_ID] - distance[SENSOR_FRONT_RIGHT_ID];
 }
 
+/**
+ * @brief Measure the lateral offset from the corridor centre line.
+ *
+ * Every side wall detected gives a measurement, and they are averaged.
+ *
+ * @param[out] offset Measured offset, in meters, positive to the left.
+ *
+ * @return Whether any side wall was detected.
+ */
+bool get_side_walls_offset(float *offset)
+{
+	int walls = 0;
+
+	*offset = 0.;
+	if (left_wall_detection()) {
+		*offset += MIDDLE_MAZE_DISTANCE - distance[SENSOR_SIDE_LEFT_ID];
+		walls++;
+	}
+	if (right_wall_detection()) {
+		*offset +=
+		    distance[SENSOR_SIDE_RIGHT_ID] - MIDDLE_MAZE_DISTANCE;
+		walls++;
+	}
+	if (!walls)
+		return false;
+	*offset /= walls;
+	return true;
+}
+
 /**
  * @brief Calculate and return the diagonal sensors error.
  *